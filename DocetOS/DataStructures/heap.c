@@ -7,6 +7,8 @@ void printHeap(OS_minHeap_t * heap);
 static uint32_t __getParentIndex(uint32_t _nodeIndexZeroBased);
 static OS_minHeapNode_t * __getPointerToItemAtIndex(OS_minHeap_t * heap, uint32_t _nodeIndexZeroBased);
 static void __heapDown(OS_minHeap_t * _heap,uint32_t _index_of_node_to_remove);
+static uint32_t __isNodeBefore(OS_minHeap_t * _heap, OS_minHeapNode_t const volatile * _node, OS_minHeapNode_t const volatile * _otherNode);
+static uint32_t __addSegments(OS_minHeap_t * _heap, uint32_t _numSegments);
 
 //================================================================================
 // Exported Functions
@@ -22,10 +24,11 @@ usefull.
 	 to the node index, this is useful for quickly retrieving the location of the node that stores "content"
 */
 OS_minHeap_t * new_heap(uint32_t _maxNumberOfHeapNodes, uint32_t _enableQuickNodeContentIndexLookup){
+	/*assertions for debugging*/
+	ASSERT(_maxNumberOfHeapNodes > 0);
 	
 	//allocating memory
 	OS_minHeap_t * heap_struct = (OS_minHeap_t *)OS_alloc(sizeof(OS_minHeap_t)/4);
-	OS_minHeapNode_t * node_Array = (OS_minHeapNode_t *)OS_alloc(_maxNumberOfHeapNodes*sizeof(OS_minHeapNode_t)/4);
 
 	/*This adds a hashtable which stores the index of the node with a given content. This allows the user to quickly obtain the index of any node
 	given that the user knows the content pointer they are trying to locate. this is useful in combination with the OS_heap_removeNodeAt function*/
@@ -34,25 +37,54 @@ OS_minHeap_t * new_heap(uint32_t _maxNumberOfHeapNodes, uint32_t _enableQuickNod
 	}else{
 		heap_struct->nodeContentIndexHashTable = NULL;
 	}
-	/*assertions for debugging*/
-	ASSERT(_maxNumberOfHeapNodes > 0);
 	
 	/* setting up heap with default node values*/
-	heap_struct->ptrToUnderlyingArray = node_Array;
-	heap_struct->maxNumberOfNodes = _maxNumberOfHeapNodes;
-	heap_struct->nextEmptyElement = node_Array; //at first the first free heap node is the topmost node
-	heap_struct->lastArrayElement = node_Array + (_maxNumberOfHeapNodes-1); // points to last node in heap
+	heap_struct->segments = NULL;
+	heap_struct->numSegments = 0;
+	heap_struct->segmentTableSize = 0;
+	heap_struct->maxNumberOfNodes = 0;
 	heap_struct->currentNumNodes = 0;
-	for (uint32_t i = 0;i<_maxNumberOfHeapNodes;i++){
-		/*this is not really needed since the value of a node beyond write_ptr-1 is irrelevant,
-		 * but this makes it easier to see what is going on when printing out heap content*/
-			heap_struct->ptrToUnderlyingArray[i].ptrToNodeContent = NULL;
-			heap_struct->ptrToUnderlyingArray[i].nodeValue = UINT32_MAX;
-	};
+	heap_struct->fifoTies = 0;
+	heap_struct->nextSequence = 0;
+	__addSegments(heap_struct,(_maxNumberOfHeapNodes + HEAP_SEGMENT_NODES - 1) >> HEAP_SEGMENT_SHIFT);
 	
 	return heap_struct;
 }
 
+/* Adds segments obtained from the memcluster until the heap can hold _newMaxNumberOfHeapNodes nodes. Existing nodes stay where they
+are, so the heap property is not affected and nothing is copied apart from the table of segment pointers (only when that is full).
+
+NOTE: a heap with quick node content index lookup cannot grow, the capacity of its hashtable is fixed. The caller must make sure the
+memcluster can be used (see OS_isMemclusterInUse) if this is called from handler mode.
+
+RETURNS:
+-> status_code: 1 if the heap can now hold _newMaxNumberOfHeapNodes nodes, 0 if not (e.g out of memory, the segments that could be
+	 allocated are kept)*/
+uint32_t OS_heap_grow(OS_minHeap_t * _heap, uint32_t _newMaxNumberOfHeapNodes){
+	if(_newMaxNumberOfHeapNodes <= _heap->maxNumberOfNodes){
+		return 1; // big enough already
+	}
+	if(_heap->nodeContentIndexHashTable){
+		return 0;
+	}
+	if(_newMaxNumberOfHeapNodes > HEAP_MAX_NODES){
+		printf("\r\nHEAP: ERROR, cannot grow heap to %d nodes, the segment table has room for at most %d nodes!\r\n",_newMaxNumberOfHeapNodes,HEAP_MAX_NODES);
+		return 0;
+	}
+	uint32_t numSegments = (_newMaxNumberOfHeapNodes + HEAP_SEGMENT_NODES - 1) >> HEAP_SEGMENT_SHIFT;
+	return __addSegments(_heap,numSegments - _heap->numSegments);
+}
+
+/* Selects how nodes with equal node values are ordered:
+-> _enable = 0 (default): in no particular order, it depends on the shape of the heap at the time the nodes are added and removed.
+-> _enable = 1: first in first out. Every node is stamped with the order it was added in, and a node only moves above another node
+	 of equal value if it was added before it. A scheduler that re-adds the task it removed therefore runs tasks of equal value round
+	 robin, and a task waits for at most (number of tasks with an equal value - 1) removals before it is removed itself.
+Changing the setting whilst the heap holds nodes does not reorder them, only later operations use the new setting.*/
+void OS_heap_setFifoTies(OS_minHeap_t * _heap, uint32_t _enable){
+	_heap->fifoTies = _enable ? 1 : 0;
+}
+
 /* 	adding a Node (containing a pointer) to the heap. The heap property is then restored automatically.
 
 PARAMETERS:
@@ -65,15 +97,16 @@ RETURNS:
 -> status_code: 1 if element added successfully, 0 if not (for example if the heap is full)*/
 uint32_t OS_heap_addNode(OS_minHeap_t * _heap, void * const _elementToAdd, const uint32_t _valueToOrderBy){
 	// is there space in the heap ?
-	if (_heap->lastArrayElement < _heap->nextEmptyElement){
+	if (_heap->currentNumNodes >= _heap->maxNumberOfNodes){
 		return 0; // cant add node, no space
 	}
 	
 	/* restoring heap property */
-	volatile OS_minHeapNode_t * node = _heap->nextEmptyElement;
+	uint32_t currentNodeIndex = _heap->currentNumNodes;
+	OS_minHeapNode_t * node = OS_heap_nodeAt(_heap,currentNodeIndex);
 	node->ptrToNodeContent = _elementToAdd;
 	node->nodeValue = _valueToOrderBy;
-	uint32_t currentNodeIndex = _heap->nextEmptyElement - _heap->ptrToUnderlyingArray;
+	node->sequence = _heap->nextSequence++;
 	/*add new node to content index hash table if applicable*/
 	if(_heap->nodeContentIndexHashTable){
     OS_hashtable_remove(_heap->nodeContentIndexHashTable,(uint32_t)node->ptrToNodeContent);
@@ -83,7 +116,7 @@ uint32_t OS_heap_addNode(OS_minHeap_t * _heap, void * const _elementToAdd, const
 		uint32_t parentNodeIndex = __getParentIndex(currentNodeIndex);
 		OS_minHeapNode_t * parentNode = __getPointerToItemAtIndex(_heap,parentNodeIndex);
 		// compare and swap
-		if (parentNode->nodeValue > node->nodeValue){
+		if (__isNodeBefore(_heap,node,parentNode)){
 			/*if applicable update the indexes in the hashtable used to quickly retrieve the index a certain node with "content" can be found at*/
 			if(_heap->nodeContentIndexHashTable){
 				OS_hashtable_remove(_heap->nodeContentIndexHashTable,(uint32_t)node->ptrToNodeContent);
@@ -103,20 +136,18 @@ uint32_t OS_heap_addNode(OS_minHeap_t * _heap, void * const _elementToAdd, const
 				
 			}
 			/*do the swap*/
-			OS_minHeapNode_t * tempNodeArray = _heap->ptrToUnderlyingArray;
 			OS_minHeapNode_t tempNode = *node;
-			tempNodeArray[currentNodeIndex] = tempNodeArray[parentNodeIndex];
-			tempNodeArray[parentNodeIndex] = tempNode;
+			*node = *parentNode;
+			*parentNode = tempNode;
 			currentNodeIndex = parentNodeIndex;//current node index is now index of previous parent (they swapped)
-			node = &tempNodeArray[currentNodeIndex];// updating ref to current node
+			node = parentNode;// updating ref to current node
 			continue; // child node is now at position of previous parent, repeat this procedure
 		}else{
 			break; // heap property restored
 		}
 	}
-	/* updating empty element pointer */
-	_heap->nextEmptyElement++;
-	_heap->currentNumNodes = _heap->nextEmptyElement - _heap->ptrToUnderlyingArray;
+	/* updating number of nodes counter */
+	_heap->currentNumNodes++;
 	return 1;
 }
 
@@ -134,11 +165,11 @@ RETURNS:
 ->  status_code: 1 if element removed succssfully, 0 if not (for example if the heap is empty)*/
 uint32_t OS_heap_removeNode(OS_minHeap_t * _heap, void * * _returnContent){
 	/* checks */
-	if(_heap->ptrToUnderlyingArray == _heap->nextEmptyElement){
+	if(_heap->currentNumNodes == 0){
 		return 0; // cant remove node, heap empty
 	}
 	/* return content pointer of element 0 (via _returnContent) and restore heap property*/
-	const OS_minHeapNode_t nodeToReturn = _heap->ptrToUnderlyingArray[0];
+	const OS_minHeapNode_t nodeToReturn = *OS_heap_nodeAt(_heap,0);
 	__heapDown(_heap,0);
 	/* returning values*/
 	*_returnContent = nodeToReturn.ptrToNodeContent;
@@ -150,7 +181,7 @@ uint32_t * peek(OS_minHeap_t * _heap,uint32_t _index){
 	if(_index >= _heap->currentNumNodes){
 		return NULL;
 	}
-	const OS_minHeapNode_t nodeToReturn = _heap->ptrToUnderlyingArray[_index];
+	const OS_minHeapNode_t nodeToReturn = *OS_heap_nodeAt(_heap,_index);
 	return nodeToReturn.ptrToNodeContent;
 }
 
@@ -182,12 +213,12 @@ RETURNS:
 ->  status_code: 1 if element removed succssfully, 0 if not*/
 uint32_t OS_heap_removeNodeAt(OS_minHeap_t * _heap,uint32_t _index, void * * _returnContent){
 	/*is the provided index within the range of valid nodes?*/
-	if(_index > _heap->currentNumNodes-1){
+	if(_index >= _heap->currentNumNodes){
 		printf("HEAP: ERROR the provided index %d is outside of the heap (max index %d)",_index,_heap->currentNumNodes-1);
         ASSERT(0);
         return 0;
 	}
-	const OS_minHeapNode_t nodeToReturn = _heap->ptrToUnderlyingArray[_index];
+	const OS_minHeapNode_t nodeToReturn = *OS_heap_nodeAt(_heap,_index);
 	__heapDown(_heap,_index);
 	*_returnContent = nodeToReturn.ptrToNodeContent;
 	return 1;
@@ -210,60 +241,59 @@ uint32_t OS_heap_getSecondChildIndex(uint32_t _nodeIndexZeroBased){
 //================================================================================
 
 static void __heapDown(OS_minHeap_t * _heap,uint32_t _index_of_node_to_remove){
-	uint32_t elemIdx = (_heap->nextEmptyElement-1) - _heap->ptrToUnderlyingArray; // index of lowest heap node
+	uint32_t elemIdx = _heap->currentNumNodes-1; // index of lowest heap node
+	OS_minHeapNode_t * lowestNode = OS_heap_nodeAt(_heap,elemIdx);
 	/*if applicable update the indexes in the hashtable used to quickly retrieve the index a certain node with "content" can be found at*/
 	if(_heap->nodeContentIndexHashTable){
-		OS_minHeapNode_t lowestIdxNode = _heap->ptrToUnderlyingArray[elemIdx];
-		OS_minHeapNode_t nodeToRemove = _heap->ptrToUnderlyingArray[_index_of_node_to_remove];
+		OS_minHeapNode_t lowestIdxNode = *lowestNode;
+		OS_minHeapNode_t nodeToRemove = *OS_heap_nodeAt(_heap,_index_of_node_to_remove);
 		uint32_t * ret1 = OS_hashtable_remove(_heap->nodeContentIndexHashTable,(uint32_t)lowestIdxNode.ptrToNodeContent);
 		uint32_t * ret2 = OS_hashtable_remove(_heap->nodeContentIndexHashTable,(uint32_t)nodeToRemove.ptrToNodeContent);
 		uint32_t ret3 = OS_hashtable_put(_heap->nodeContentIndexHashTable,(uint32_t)lowestIdxNode.ptrToNodeContent,(uint32_t*)_index_of_node_to_remove, HASHTABLE_REJECT_MULTIPLE_VALUES_PER_KEY);
 	}
 	//swapping, inserting lowest node at index _index_of_node_to_remove
-	_heap->ptrToUnderlyingArray[_index_of_node_to_remove] = _heap->ptrToUnderlyingArray[elemIdx];
+	*OS_heap_nodeAt(_heap,_index_of_node_to_remove) = *lowestNode;
 	//erasing data from node (this is not strictly necessary)
-	_heap->ptrToUnderlyingArray[elemIdx].nodeValue = UINT32_MAX;
-	_heap->ptrToUnderlyingArray[elemIdx].ptrToNodeContent = NULL;
-	//updating number of nodes counter and empty node pointer (one less node now)
-	_heap->nextEmptyElement--;//node removed, so need to move empty element pointer
-	_heap->currentNumNodes = _heap->nextEmptyElement - _heap->ptrToUnderlyingArray;
+	lowestNode->nodeValue = UINT32_MAX;
+	lowestNode->ptrToNodeContent = NULL;
+	//updating number of nodes counter (one less node now)
+	_heap->currentNumNodes--;
 	//if the removed node was the lowest node in heap then the heap property is intact.
 	if(elemIdx == _index_of_node_to_remove){
 		return;
 	}
 	// restore heap property (heap down)
 	elemIdx = _index_of_node_to_remove; //index where node was removed
-	const int maxValidIdx = (_heap->nextEmptyElement-1) - _heap->ptrToUnderlyingArray;
-	while(maxValidIdx != -1 ){// maxValidIdx is -1 when nextEmptyElement == ptrToUnderlyingArray
+	const uint32_t numValidNodes = _heap->currentNumNodes;
+	while(1){
 		uint32_t firstChildIdx = OS_heap_getFirstChildIndex(elemIdx);
 		uint32_t secondChildIdx = OS_heap_getSecondChildIndex(elemIdx);
-		OS_minHeapNode_t firstChild = _heap->ptrToUnderlyingArray[firstChildIdx];
-		OS_minHeapNode_t secondChild = _heap->ptrToUnderlyingArray[secondChildIdx];
 		// are both returned indicies valid nodes (not UNUSED) ?
 		uint32_t smallerChildIdx;
-		if(secondChildIdx <= maxValidIdx){
+		if(secondChildIdx < numValidNodes){
 			//no need to check first childIdx when second childIdx is valid
-			smallerChildIdx = (firstChild.nodeValue <= secondChild.nodeValue)?firstChildIdx:secondChildIdx;
-		}else if(firstChildIdx <= maxValidIdx){
+			smallerChildIdx = __isNodeBefore(_heap,OS_heap_nodeAt(_heap,secondChildIdx),OS_heap_nodeAt(_heap,firstChildIdx))?secondChildIdx:firstChildIdx;
+		}else if(firstChildIdx < numValidNodes){
 			smallerChildIdx = firstChildIdx;
 		}else{
 			// node has no children, nothing to swap, heap property restored
 			break;
 		}
 		// swap (only if node value is larger than that of child)
-		OS_minHeapNode_t currentNode = _heap->ptrToUnderlyingArray[elemIdx];
-		if (currentNode.nodeValue > _heap->ptrToUnderlyingArray[smallerChildIdx].nodeValue){
+		OS_minHeapNode_t * currentNode = OS_heap_nodeAt(_heap,elemIdx);
+		OS_minHeapNode_t * childNode = OS_heap_nodeAt(_heap,smallerChildIdx);
+		if (__isNodeBefore(_heap,childNode,currentNode)){
 			/*if applicable update the indexes in the hashtable used to quickly retrieve the index at which a certain node with "content" can be found at*/
 			if(_heap->nodeContentIndexHashTable){
-				OS_minHeapNode_t childNode = _heap->ptrToUnderlyingArray[smallerChildIdx];
-				OS_hashtable_remove(_heap->nodeContentIndexHashTable,(uint32_t)currentNode.ptrToNodeContent);
-				OS_hashtable_remove(_heap->nodeContentIndexHashTable,(uint32_t)childNode.ptrToNodeContent);
-				OS_hashtable_put(_heap->nodeContentIndexHashTable,(uint32_t)currentNode.ptrToNodeContent,(uint32_t*)smallerChildIdx, HASHTABLE_REJECT_MULTIPLE_VALUES_PER_KEY);
-				OS_hashtable_put(_heap->nodeContentIndexHashTable,(uint32_t)childNode.ptrToNodeContent,(uint32_t*)elemIdx, HASHTABLE_REJECT_MULTIPLE_VALUES_PER_KEY);
+				OS_hashtable_remove(_heap->nodeContentIndexHashTable,(uint32_t)currentNode->ptrToNodeContent);
+				OS_hashtable_remove(_heap->nodeContentIndexHashTable,(uint32_t)childNode->ptrToNodeContent);
+				OS_hashtable_put(_heap->nodeContentIndexHashTable,(uint32_t)currentNode->ptrToNodeContent,(uint32_t*)smallerChildIdx, HASHTABLE_REJECT_MULTIPLE_VALUES_PER_KEY);
+				OS_hashtable_put(_heap->nodeContentIndexHashTable,(uint32_t)childNode->ptrToNodeContent,(uint32_t*)elemIdx, HASHTABLE_REJECT_MULTIPLE_VALUES_PER_KEY);
 			}
 			/*swap*/
-			_heap->ptrToUnderlyingArray[elemIdx] = _heap->ptrToUnderlyingArray[smallerChildIdx];
-			_heap->ptrToUnderlyingArray[smallerChildIdx] = currentNode;
+			OS_minHeapNode_t tempNode = *currentNode;
+			*currentNode = *childNode;
+			*childNode = tempNode;
 			elemIdx = smallerChildIdx;
 		}else{
 			//node value is smaller than its children, heap property restored
@@ -272,6 +302,56 @@ static void __heapDown(OS_minHeap_t * _heap,uint32_t _index_of_node_to_remove){
 	}
 }
 
+/* allocates _numSegments more segments (growing the table of segment pointers if it is full) and initialises their nodes.
+
+RETURNS: 1 if every segment was added, 0 if the memcluster ran out of memory (the segments added until then are kept)*/
+static uint32_t __addSegments(OS_minHeap_t * _heap, uint32_t _numSegments){
+	uint32_t requiredTableSize = _heap->numSegments + _numSegments;
+	if(requiredTableSize > _heap->segmentTableSize){
+		uint32_t tableSize = _heap->segmentTableSize ? _heap->segmentTableSize : (1UL << SMALLEST_BLOCK_SIZE);
+		while(tableSize < requiredTableSize){
+			tableSize *= 2;
+		}
+		OS_minHeapNode_t ** table = (OS_minHeapNode_t **)OS_alloc(tableSize*sizeof(OS_minHeapNode_t *)/4);
+		if(table == NULL){
+			return 0;
+		}
+		for(uint32_t i=0;i<_heap->numSegments;i++){
+			table[i] = _heap->segments[i];
+		}
+		if(_heap->segments){
+			OS_free((uint32_t*)_heap->segments);
+		}
+		_heap->segments = table;
+		_heap->segmentTableSize = tableSize;
+	}
+	for(uint32_t i=0;i<_numSegments;i++){
+		OS_minHeapNode_t * segment = (OS_minHeapNode_t *)OS_alloc(HEAP_SEGMENT_NODES*sizeof(OS_minHeapNode_t)/4);
+		if(segment == NULL){
+			return 0;
+		}
+		for(uint32_t j=0;j<HEAP_SEGMENT_NODES;j++){
+			/*this is not really needed since the value of a node beyond currentNumNodes is irrelevant,
+			 * but this makes it easier to see what is going on when printing out heap content*/
+			segment[j].ptrToNodeContent = NULL;
+			segment[j].nodeValue = UINT32_MAX;
+			segment[j].sequence = 0;
+		}
+		_heap->segments[_heap->numSegments++] = segment;
+		_heap->maxNumberOfNodes += HEAP_SEGMENT_NODES;
+	}
+	return 1;
+}
+
+/* RETURNS: 1 if _node has to be above _otherNode in the heap, i.e. it has a smaller value or (with fifoTies) an equal value and was
+added earlier. Sequences are compared wrap-safe, so this stays correct as long as fewer than 2^31 nodes are added whilst a node is in the heap.*/
+static uint32_t __isNodeBefore(OS_minHeap_t * _heap, OS_minHeapNode_t const volatile * _node, OS_minHeapNode_t const volatile * _otherNode){
+	if(_node->nodeValue != _otherNode->nodeValue){
+		return _node->nodeValue < _otherNode->nodeValue;
+	}
+	return _heap->fifoTies && (int32_t)(_node->sequence - _otherNode->sequence) < 0;
+}
+
 /* Get the index of the parent of node C
 (Note: the index for nodes in this min heap is ZERO BASED!)*/
 static uint32_t __getParentIndex(uint32_t _nodeIndexZeroBased){
@@ -297,7 +377,7 @@ static OS_minHeapNode_t * __getPointerToItemAtIndex(OS_minHeap_t * heap, uint32_
         return NULL;
 	}
 	/* get pointer:*/
-	return &(heap->ptrToUnderlyingArray[_nodeIndexZeroBased]);
+	return OS_heap_nodeAt(heap,_nodeIndexZeroBased);
 }
 
 //================================================================================
@@ -309,10 +389,9 @@ Example of output:
 >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>> DEBUG <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 ----------------------------------------------------------------------------------------------------------------
 GENERAL INFO:
-capacity:					5
-ptr_to_underlying_array:	200009d4
-ptr_next_empty_elem:		200009e4
-ptr_last_elem:				200009f4
+capacity:					32
+segments:					1
+num_nodes:					2
 
 HEAP CONTENTS:
 [STATUS]            [INDEX]             [RELATION]          [NODE_VALUE]        [NODE_PTR]          [CONTENT_PTR]       
@@ -327,14 +406,13 @@ void printHeap(OS_minHeap_t * heap){
 	printf("----------------------------------------------------------------------------------------------------------------\r\n");
 	printf("GENERAL INFO:\r\n");
 	printf("capacity:%-40d\r\n",heap->maxNumberOfNodes);
-	printf("ptr_to_underlying_array:%-40p\r\n",heap->ptrToUnderlyingArray);
-	printf("ptr_next_empty_elem:%-40p\r\n",heap->nextEmptyElement);
-	printf("ptr_last_elem:%-40p\r\n",heap->lastArrayElement);
+	printf("segments:%-40d\r\n",heap->numSegments);
+	printf("num_nodes:%-40d\r\n",heap->currentNumNodes);
 	printf("\r\nHEAP CONTENTS:\r\n");
 	printf("%-20s%-20s%-20s%-20s%-20s%-20s\r\n","[STATUS]","[INDEX]","[RELATION]","[NODE_VALUE]","[NODE_PTR]","[CONTENT_PTR]");
 	//zero node
-	OS_minHeapNode_t * zero_node = heap->ptrToUnderlyingArray;
-	if(heap->ptrToUnderlyingArray == heap->nextEmptyElement){
+	OS_minHeapNode_t * zero_node = __getPointerToItemAtIndex(heap,0);
+	if(heap->currentNumNodes == 0){
 		printf("%-20s%-20d%-20s%-20d%-20p%-20p\r\n","-WPtr->",0,"N/A",zero_node->nodeValue,zero_node,zero_node->ptrToNodeContent);
 	}else{
 		printf("%-20s%-20d%-20s%-20d%-20p%-20p\r\n","",0,"N/A",zero_node->nodeValue,zero_node,zero_node->ptrToNodeContent);
@@ -347,9 +425,9 @@ void printHeap(OS_minHeap_t * heap){
 		OS_minHeapNode_t * parentNode = __getPointerToItemAtIndex(heap,parentIdx);
 		char relation[64];
 		sprintf(relation,"%d.%d",parentIdx,childNum);
-		if(node < heap->nextEmptyElement){
+		if(i < heap->currentNumNodes){
 			printf("%-20s%-20d%-20s%-20d%-20p%-20p\r\n","",i,relation,node->nodeValue,node,node->ptrToNodeContent);
-		}else if (node == heap->nextEmptyElement){
+		}else if (i == heap->currentNumNodes){
 			printf("%-20s%-20d%-20s%-20d%-20p%-20p\r\n","-WPtr->",i,relation,node->nodeValue,node,node->ptrToNodeContent);
 		}else{
 			printf("%-20s%-20d%-20s%-20d%-20p%-20p\r\n","[UNUSED]",i,relation,node->nodeValue,node,node->ptrToNodeContent);
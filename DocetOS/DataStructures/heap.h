@@ -7,7 +7,16 @@
 #include "structs.h"
 #include "os.h"
 #include "hashtable.h"
+#include "memcluster.h"
 #define MAX_HEAP_SIZE 63 // 2^N - 1 , where n is the number of desired levels in binary tree
+/* nodes are stored in segments of 2^HEAP_SEGMENT_SHIFT nodes, a segment (32 nodes of 3 words) has to fit into one memcluster block*/
+#define HEAP_SEGMENT_SHIFT 5
+#define HEAP_SEGMENT_NODES (1UL << HEAP_SEGMENT_SHIFT)
+/* the table of segment pointers is a single memcluster block, which limits a heap to 2^LARGEST_BLOCK_SIZE segments (8192 nodes with
+ * the default memcluster, far more tasks than fit into the memory of the MCU)*/
+#define HEAP_MAX_NODES ((1UL << LARGEST_BLOCK_SIZE) << HEAP_SEGMENT_SHIFT)
+/* pointer to the node at the given (zero based) index, the index has to be below maxNumberOfNodes*/
+#define OS_heap_nodeAt(heap,index) (&(heap)->segments[(index) >> HEAP_SEGMENT_SHIFT][(index) & (HEAP_SEGMENT_NODES - 1)])
 #define CONTENT_INDEX_LOOKUP_HASHTABLE_BUCKETS_NUM 8
 
 
@@ -18,6 +27,9 @@ OS_minHeap_t * new_heap(uint32_t _maxNumberOfHeapNodes,uint32_t _enableQuickNode
 /*NOTE:
  * the return value (uint32_t) in these functions ALWAYS indicates a status code (success/failure) of
  * the operation. Other returns (e.g index of a node) are obtained */
+/* adds segments until the heap can hold _newMaxNumberOfHeapNodes nodes, which must not exceed HEAP_MAX_NODES*/
+uint32_t OS_heap_grow(OS_minHeap_t * _heap, uint32_t _newMaxNumberOfHeapNodes);
+void OS_heap_setFifoTies(OS_minHeap_t * _heap, uint32_t _enable);
 uint32_t OS_heap_addNode(OS_minHeap_t * heap_to_operate_on, void * const element_to_add, const uint32_t value_to_order_by);
 uint32_t OS_heap_removeNode(OS_minHeap_t * _heap, void * * _return_content);
 uint32_t OS_heap_removeNodeAt(OS_minHeap_t * _heap,uint32_t _index, void * * _return_content);
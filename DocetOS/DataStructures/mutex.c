@@ -5,10 +5,12 @@
 //================================================================================
 
 void OS_init_mutex(OS_mutex_t * mutex){
+	OS_waitList_init(&mutex->waiters);
 	mutex->counter = 0;
 	mutex->svcDelegatesEnabled = 1;
 	mutex->tcbPointer = NULL; // NULL is just 0 ofc, but i think this makes it clearer
   mutex->nextAcquiredResource = NULL;
+	mutex->maxWaiterPriority = 0;
 };
 
 /*Allocates and initialises mutex.
@@ -35,7 +37,7 @@ void OS_mutex_acquire(OS_mutex_t * _mutex){
 	uint32_t lockNotObtained;
 	OS_TCB_t * currentTCB = OS_currentTCB();
 	while(1){
-		uint32_t checkCode = OS_checkCode();
+		uint32_t checkCode = OS_checkCode(_mutex);
 		mutexTcbPtr = (uint32_t)__LDREXW((uint32_t*) &(_mutex->tcbPointer));
 		if(mutexTcbPtr == NULL || mutexTcbPtr == (uint32_t)OS_currentTCB()){
 			//no tcb has locked the mutex, try and aquire lock
@@ -50,7 +52,8 @@ void OS_mutex_acquire(OS_mutex_t * _mutex){
 				break; //got the lock
 			}
 		}else{
-			//somebody else holds the lock, wait for its release
+			/*somebody else holds the lock, wait for its release. The releasing task hands the lock over to the highest priority
+			waiter by writing its TCB into tcbPointer, so once woken the task finds itself as the owner and takes the branch above*/
 			if(_mutex->svcDelegatesEnabled){
 				/*during certain sections of the scheduler it is necessary to disable the mutex calling svc delegates,
 				(see task exit and tcb/stack deallocation), hence the svcDelegatesEnabled Flag*/
@@ -67,7 +70,7 @@ void OS_mutex_acquire(OS_mutex_t * _mutex){
 uint32_t OS_mutex_acquire_non_blocking(OS_mutex_t * _mutex){
 	uint32_t mutexTcbPtr;
 	uint32_t lockNotObtained;
-	uint32_t checkCode = OS_checkCode();
+	uint32_t checkCode = OS_checkCode(_mutex);
 	//attempt to get lock
 	mutexTcbPtr = (uint32_t)__LDREXW((uint32_t*) &(_mutex->tcbPointer));
 	if(mutexTcbPtr == NULL){
@@ -98,7 +101,7 @@ void OS_mutex_release(OS_mutex_t * _mutex){
 		//releasing lock fully
 		_mutex->tcbPointer = NULL;
 		if(_mutex->svcDelegatesEnabled && currentTCB != NULL){
-			OS_notify(_mutex);
+			OS_notifyOne(_mutex,1);//hands the lock to the highest priority waiter (if any)
 			OS_yield();//give other tasks a chance to get lock
 		}
 	}
@@ -120,9 +123,124 @@ void OS_mutex_release_noYield(OS_mutex_t * _mutex){
             return;//not a task, dont try and sleep !!
         }
         if(_mutex->svcDelegatesEnabled){
-            OS_notify(_mutex);
+            OS_notifyOne(_mutex,1);
         }
     }
 }
 
+//================================================================================
+// scheduler support
+//================================================================================
+/* The following functions are called by the schedulers from their svc callbacks (handler mode). They hold the parts of mutex handling
+that do not depend on how a scheduler keeps its ready tasks, so every scheduler behaves the same.*/
+
+/* called by notifyOne when the mutex has been released: the mutex is handed to the highest priority waiter that is not suspended
+directly, tcbPointer is set to the woken task, so no other task can take the mutex before it runs and it acquires it without waiting
+again. Should another task have taken the mutex in between the release and this call nobody is woken, the new owner notifies the
+waiters once it releases the mutex.
+
+RETURNS: the woken task (the new owner), NULL if no waiter was handed the mutex. The scheduler has to make it ready again.*/
+OS_TCB_t * OS_mutex_handOff(OS_mutex_t * _mutex){
+	OS_TCB_t * task = OS_waitList_peekNotSuspended(&_mutex->waiters);
+	if(task && _mutex->tcbPointer == NULL){
+		_mutex->tcbPointer = task;
+		OS_waitList_wake(&_mutex->waiters,task);
+	}else{
+		task = NULL;
+	}
+	/*the remaining waiters are still queued, the new owner inherits from the highest priority one of them once it registers the mutex
+	(see OS_mutex_registerAcquired)*/
+	_mutex->maxWaiterPriority = _mutex->waiters.head ? TASK_EFFECTIVE_PRIORITY((OS_TCB_t *)_mutex->waiters.head) : 0;
+	return task;
+}
+
+/* adds a mutex the task just acquired to the list of mutexes it holds, which priority inheritance reads from.
+
+RETURNS: 1 if the mutex was added, 0 if the task already held it (acquired recursively)*/
+uint32_t OS_mutex_registerAcquired(OS_TCB_t * _task, OS_mutex_t * _mutex){
+	if(_mutex->counter != 0 || _task == NULL || _mutex == _task->acquiredResourcesLinkedList){
+		return 0;//already acquired by this task before, it is in the list already
+	}
+	_mutex->nextAcquiredResource = _task->acquiredResourcesLinkedList;
+	_task->acquiredResourcesLinkedList = _mutex;
+	return 1;
+}
+
+/* removes a resource the task has released from the list of mutexes it holds.
 
+RETURNS: 1 if the resource was found and removed, 0 if the task does not hold it (e.g. it is not a mutex)*/
+uint32_t OS_mutex_unregisterAcquired(OS_TCB_t * _task, void * _resource){
+	OS_mutex_t * prevAcquiredMutex = NULL;
+	OS_mutex_t * acquiredMutex = _task->acquiredResourcesLinkedList;
+	while(acquiredMutex){
+		if(acquiredMutex == _resource){
+			if(prevAcquiredMutex){
+				prevAcquiredMutex->nextAcquiredResource = acquiredMutex->nextAcquiredResource;
+			}else{
+				_task->acquiredResourcesLinkedList = acquiredMutex->nextAcquiredResource;
+			}
+			acquiredMutex->nextAcquiredResource = NULL;//reset to avoid infinite loop
+			return 1;
+		}
+		prevAcquiredMutex = acquiredMutex;
+		acquiredMutex = acquiredMutex->nextAcquiredResource;
+	}
+	return 0;
+}
+
+/* sets the priority the task inherits from the waiters of the mutexes it holds: the highest priority (lowest value) any of them passes
+on, read from the maxWaiterPriority cached in every mutex, provided it beats the priority the task has on its own (TASK_BIASED_PRIORITY,
+so a boosted owner never gets worse and a demoted owner inherits every waiter that outranks it). Only looks at the mutexes the task
+holds, not at the tasks waiting on them. Moving the task to its new place is up to the scheduler.*/
+void OS_mutex_updateInheritedPriority(OS_TCB_t * _task){
+	uint32_t ownPriority = TASK_BIASED_PRIORITY(_task);
+	uint32_t highestPriority = ownPriority;
+	for(OS_mutex_t * acquiredMutex = _task->acquiredResourcesLinkedList; acquiredMutex; acquiredMutex = acquiredMutex->nextAcquiredResource){
+		//REMEMBER, larger value means less priority
+		if(acquiredMutex->maxWaiterPriority && acquiredMutex->maxWaiterPriority < highestPriority){
+			highestPriority = acquiredMutex->maxWaiterPriority;
+		}
+	}
+	if(highestPriority < ownPriority){
+		_task->prevInheritedPriority = _task->inheritedPriority;
+		_task->inheritedPriority = highestPriority;
+	}else{
+		_task->inheritedPriority = 0;//nothing inherited
+		_task->prevInheritedPriority = 0;
+	}
+}
+
+/* records that a task with _waiterPriority is waiting on _mutex and passes the boost on along the chain of owners: if the owner of the
+mutex is itself waiting on a mutex, the owner of that mutex inherits the priority too, and so on. _updateOwner recomputes the inherited
+priority of an owner the way its scheduler needs it and returns 1 if the effective priority of the owner changed. The walk stops as soon
+as a priority does not improve (everything further along the chain already runs at least at that priority) or after
+PRIORITY_INHERITANCE_MAX_CHAIN_DEPTH owners, so its cost is proportional to the length of the chain.*/
+void OS_mutex_propagateInheritance(OS_mutex_t * _mutex, uint32_t _waiterPriority, uint32_t (* _updateOwner)(OS_TCB_t * _owner)){
+	for(uint32_t depth=0;_mutex && depth<PRIORITY_INHERITANCE_MAX_CHAIN_DEPTH;depth++){
+		if(_mutex->maxWaiterPriority && _mutex->maxWaiterPriority <= _waiterPriority){
+			return;// mutex already passes on an equal or higher priority
+		}
+		_mutex->maxWaiterPriority = _waiterPriority;
+		OS_TCB_t * mutexOwner = _mutex->tcbPointer;
+		if(mutexOwner == NULL || !_updateOwner(mutexOwner)){
+			return;
+		}
+		_waiterPriority = TASK_EFFECTIVE_PRIORITY(mutexOwner);
+		_mutex = mutexOwner->waitingOnMutex;
+	}
+}
+
+/* recomputes the priority _mutex passes on from its waiters after the priority of one of them changed. Unlike
+OS_mutex_propagateInheritance this also handles a waiter that became less important: the owner (and every owner further along the
+chain, at most PRIORITY_INHERITANCE_MAX_CHAIN_DEPTH) may lose the boost it inherited.*/
+void OS_mutex_refreshWaiterPriority(OS_mutex_t * _mutex, uint32_t (* _updateOwner)(OS_TCB_t * _owner)){
+	for(uint32_t depth=0;_mutex && depth<PRIORITY_INHERITANCE_MAX_CHAIN_DEPTH;depth++){
+		OS_TCB_t * headWaiter = _mutex->waiters.head;
+		_mutex->maxWaiterPriority = headWaiter ? TASK_EFFECTIVE_PRIORITY(headWaiter) : 0;
+		OS_TCB_t * mutexOwner = _mutex->tcbPointer;
+		if(mutexOwner == NULL || !_updateOwner(mutexOwner)){
+			return;
+		}
+		_mutex = mutexOwner->waitingOnMutex;
+	}
+}
@@ -6,6 +6,11 @@
 #include "structs.h"
 #include <stdio.h>
 #include "os_internal.h"
+#include "waitList.h"
+
+/* maximum number of owners a priority boost is passed along when tasks wait on mutexes whose owners wait on further mutexes
+ * (task A waits on a mutex held by B, which waits on a mutex held by C...). Bounds the time a wait() call spends in the scheduler.*/
+#define PRIORITY_INHERITANCE_MAX_CHAIN_DEPTH 8
 
 //================================================================================
 // Exported Functions
@@ -20,4 +25,12 @@ OS_mutex_t * new_mutex(void);
 uint32_t destroy_mutex(OS_mutex_t * _mutex);
 //uint32_t OS_mutex_acquire_non_blocking(OS_mutex_t * _mutex);
 
+/*used by the schedulers (handler mode), see mutex.c*/
+OS_TCB_t * OS_mutex_handOff(OS_mutex_t * _mutex);
+uint32_t OS_mutex_registerAcquired(OS_TCB_t * _task, OS_mutex_t * _mutex);
+uint32_t OS_mutex_unregisterAcquired(OS_TCB_t * _task, void * _resource);
+void OS_mutex_updateInheritedPriority(OS_TCB_t * _task);
+void OS_mutex_propagateInheritance(OS_mutex_t * _mutex, uint32_t _waiterPriority, uint32_t (* _updateOwner)(OS_TCB_t * _owner));
+void OS_mutex_refreshWaiterPriority(OS_mutex_t * _mutex, uint32_t (* _updateOwner)(OS_TCB_t * _owner));
+
 #endif /*MUTEX_H*/
@@ -0,0 +1,233 @@
+#include "readyQueue.h"
+
+//================================================================================
+// Internal Function Prototypes
+//================================================================================
+static void __addLevelWeight(OS_readyQueue_t * _queue, uint32_t _level, int32_t _weight);
+
+//================================================================================
+// Exported Functions
+//================================================================================
+
+/* Function that initialises a ready queue:
+-> the ready queue is an array of doubly linked lists (one per priority level) whose links are stored inside the
+   TCBs themselves, so adding or removing a task never allocates memory and never searches.
+-> a 32bit bitmap records which levels are non empty. The highest priority level holding a task is therefore found
+   with a single CLZ instruction regardless of the number of tasks in the queue.
+-> every level has a weight (READY_QUEUE_DEFAULT_LEVEL_WEIGHT until OS_readyQueue_setLevelWeights() is called). The summed weight
+   of the tasks in each level is kept up to date on every add and remove, so a task can be sampled with a probability proportional
+   to the weight of its level using a single random number (see OS_readyQueue_sampleLevel).
+*/
+OS_readyQueue_t * new_readyQueue(void){
+	OS_readyQueue_t * queue = (OS_readyQueue_t *)OS_alloc(sizeof(OS_readyQueue_t)/4);
+	if(queue == NULL){
+		printf("\r\nREADY_QUEUE: ERROR cannot allocate required memory!\r\n");
+		ASSERT(0);
+		return NULL;
+	}
+	queue->priorityBitmap = 0;
+	queue->numTasks = 0;
+	queue->totalWeight = 0;
+	for(uint32_t i=0;i<READY_QUEUE_NUM_LEVELS;i++){
+		queue->levelHead[i] = NULL;
+		queue->levelTail[i] = NULL;
+		queue->levelWeight[i] = READY_QUEUE_DEFAULT_LEVEL_WEIGHT;
+		queue->weightTree[i] = 0;
+	}
+	return queue;
+}
+
+/* Maps a task priority (1 = highest, minHeap convention) onto one of the READY_QUEUE_NUM_LEVELS levels. Priorities
+beyond the number of levels share the lowest level.*/
+uint32_t OS_readyQueue_levelOfPriority(uint32_t _priority){
+	if(_priority == 0){
+		return 0;
+	}
+	if(_priority > READY_QUEUE_NUM_LEVELS){
+		return READY_QUEUE_NUM_LEVELS - 1;
+	}
+	return _priority - 1;
+}
+
+/* appends _task to the tail of the list that corresponds to _priority.
+
+NOTE: the task must not be linked into any ready queue when this is called (a task can only be in one list at a time)*/
+void OS_readyQueue_add(OS_readyQueue_t * _queue, OS_TCB_t * _task, uint32_t _priority){
+	if(_task->readyLevel != READY_QUEUE_LEVEL_NONE){
+		printf("\r\nREADY_QUEUE: ERROR task %p is already linked into level %d!\r\n",_task,_task->readyLevel);
+		ASSERT(0);
+		return;
+	}
+	uint32_t level = OS_readyQueue_levelOfPriority(_priority);
+	OS_TCB_t * tail = _queue->levelTail[level];
+	_task->readyNext = NULL;
+	_task->readyPrev = tail;
+	_task->readyLevel = level;
+	if(tail){
+		tail->readyNext = _task;
+	}else{
+		_queue->levelHead[level] = _task;
+		_queue->priorityBitmap |= (1UL << (31 - level));
+	}
+	_queue->levelTail[level] = _task;
+	_queue->numTasks++;
+	__addLevelWeight(_queue,level,(int32_t)_queue->levelWeight[level]);
+}
+
+/* unlinks _task from the list it is currently in.
+
+RETURNS: 1 if the task was linked and has been removed, 0 if it was not linked into the queue*/
+uint32_t OS_readyQueue_remove(OS_readyQueue_t * _queue, OS_TCB_t * _task){
+	uint32_t level = _task->readyLevel;
+	if(level == READY_QUEUE_LEVEL_NONE){
+		return 0;
+	}
+	OS_TCB_t * prev = _task->readyPrev;
+	OS_TCB_t * next = _task->readyNext;
+	if(prev){
+		prev->readyNext = next;
+	}else{
+		_queue->levelHead[level] = next;
+	}
+	if(next){
+		next->readyPrev = prev;
+	}else{
+		_queue->levelTail[level] = prev;
+	}
+	if(_queue->levelHead[level] == NULL){
+		_queue->priorityBitmap &= ~(1UL << (31 - level));
+	}
+	_task->readyNext = NULL;
+	_task->readyPrev = NULL;
+	_task->readyLevel = READY_QUEUE_LEVEL_NONE;
+	_queue->numTasks--;
+	__addLevelWeight(_queue,level,-(int32_t)_queue->levelWeight[level]);
+	return 1;
+}
+
+/* RETURNS: 1 if the task is currently linked into a ready queue, 0 otherwise*/
+uint32_t OS_readyQueue_contains(OS_TCB_t * _task){
+	return _task->readyLevel != READY_QUEUE_LEVEL_NONE;
+}
+
+/* RETURNS: the highest priority (lowest index) level that holds a task, READY_QUEUE_NO_LEVEL if the queue is empty*/
+uint32_t OS_readyQueue_highestLevel(OS_readyQueue_t * _queue){
+	return __CLZ(_queue->priorityBitmap);// CLZ(0) is 32 which equals READY_QUEUE_NO_LEVEL
+}
+
+/* RETURNS: the lowest priority (highest index) level that holds a task, READY_QUEUE_NO_LEVEL if the queue is empty*/
+uint32_t OS_readyQueue_lowestLevel(OS_readyQueue_t * _queue){
+	if(_queue->priorityBitmap == 0){
+		return READY_QUEUE_NO_LEVEL;
+	}
+	return 31 - OS_COUNT_TRAILING_ZEROS(_queue->priorityBitmap);
+}
+
+/* RETURNS: the task at the head of the list for _level without removing it (NULL if the list is empty)*/
+OS_TCB_t * OS_readyQueue_peekLevel(OS_readyQueue_t * _queue, uint32_t _level){
+	if(_level >= READY_QUEUE_NUM_LEVELS){
+		return NULL;
+	}
+	return _queue->levelHead[_level];
+}
+
+/* moves the task at the head of the list for _level to its tail, this is how tasks that share a level take turns.
+
+RETURNS: the task that was at the head of the list (NULL if the list is empty)*/
+OS_TCB_t * OS_readyQueue_rotateLevel(OS_readyQueue_t * _queue, uint32_t _level){
+	if(_level >= READY_QUEUE_NUM_LEVELS){
+		return NULL;
+	}
+	OS_TCB_t * head = _queue->levelHead[_level];
+	if(head == NULL || head->readyNext == NULL){
+		return head;// zero or one task, nothing to rotate
+	}
+	OS_TCB_t * newHead = head->readyNext;
+	OS_TCB_t * tail = _queue->levelTail[_level];
+	newHead->readyPrev = NULL;
+	_queue->levelHead[_level] = newHead;
+	head->readyNext = NULL;
+	head->readyPrev = tail;
+	tail->readyNext = head;
+	_queue->levelTail[_level] = head;
+	return head;
+}
+
+/* sets the weight of every level to _weightOfPriority(priority), where priority is the highest task priority that maps onto the level
+(see OS_readyQueue_levelOfPriority). The summed weights are rebuilt from the tasks currently in the queue, which takes time
+proportional to the number of tasks, so this is meant to be called at init or rarely afterwards.
+
+NOTE: the weight of the whole queue must fit into 32 bits, i.e. (largest weight) * (number of ready tasks) < 2^32*/
+void OS_readyQueue_setLevelWeights(OS_readyQueue_t * _queue, uint32_t (* _weightOfPriority)(uint32_t _priority)){
+	_queue->totalWeight = 0;
+	for(uint32_t level=0;level<READY_QUEUE_NUM_LEVELS;level++){
+		_queue->levelWeight[level] = _weightOfPriority(level + 1);
+		_queue->weightTree[level] = 0;
+	}
+	for(uint32_t level=0;level<READY_QUEUE_NUM_LEVELS;level++){
+		for(OS_TCB_t * task = _queue->levelHead[level]; task; task = task->readyNext){
+			__addLevelWeight(_queue,level,(int32_t)_queue->levelWeight[level]);
+		}
+	}
+}
+
+/* picks a level with a probability equal to the summed weight of its tasks divided by the weight of the whole queue, so (together with
+rotating the tasks of a level, see OS_readyQueue_rotateLevel) every task receives a share proportional to the weight of its level.
+_random is a uniformly distributed 32bit number, it is scaled onto the total weight with a multiply instead of a division. The level is
+then found by descending the fenwick tree, which always takes log2(READY_QUEUE_NUM_LEVELS) steps.
+
+RETURNS: the sampled level. The highest priority non empty level if every task in the queue has a weight of 0, READY_QUEUE_NO_LEVEL if
+the queue is empty*/
+uint32_t OS_readyQueue_sampleLevel(OS_readyQueue_t * _queue, uint32_t _random){
+	if(_queue->totalWeight == 0){
+		return OS_readyQueue_highestLevel(_queue);
+	}
+	uint32_t target = (uint32_t)(((uint64_t)_random * _queue->totalWeight) >> 32);
+	uint32_t position = 0;
+	for(uint32_t step = READY_QUEUE_NUM_LEVELS/2; step; step >>= 1){
+		uint32_t next = position + step;
+		if(_queue->weightTree[next - 1] <= target){
+			target -= _queue->weightTree[next - 1];
+			position = next;
+		}
+	}
+	return position;
+}
+
+//================================================================================
+// Internal Functions
+//================================================================================
+
+/* adds _weight (negative to subtract) to the summed weight of _level. weightTree[i-1] holds the sum of the levels (i - lowbit(i), i]*/
+static void __addLevelWeight(OS_readyQueue_t * _queue, uint32_t _level, int32_t _weight){
+	for(uint32_t i = _level + 1; i <= READY_QUEUE_NUM_LEVELS; i += i & (~i + 1)){
+		_queue->weightTree[i - 1] += (uint32_t)_weight;
+	}
+	_queue->totalWeight += (uint32_t)_weight;
+}
+
+//================================================================================
+// DEBUG FUNCTIONS
+//================================================================================
+
+void DEBUG_printReadyQueue(OS_readyQueue_t * _queue){
+	printf("----------------------------------------------------------------------------------------------------------------\r\n");
+	printf("GENERAL INFO:\r\n");
+	printf("number of tasks:%-40d\r\n",_queue->numTasks);
+	printf("priority bitmap:0x%08x\r\n",_queue->priorityBitmap);
+	printf("total weight:%-40d\r\n",_queue->totalWeight);
+	printf("\r\nREADY QUEUE CONTENTS:\r\n");
+	for(uint32_t level=0;level<READY_QUEUE_NUM_LEVELS;level++){
+		OS_TCB_t * task = _queue->levelHead[level];
+		if(task == NULL){
+			continue;
+		}
+		printf("LEVEL %d:",level);
+		while(task){
+			printf(" %p",task);
+			task = task->readyNext;
+		}
+		printf("\r\n");
+	}
+	printf("----------------------------------------------------------------------------------------------------------------\n\r\n");
+}
@@ -0,0 +1,33 @@
+#ifndef DOCETOS_READYQUEUE_H
+#define DOCETOS_READYQUEUE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "../OS/debug.h"
+#include "structs.h"
+#include "os.h"
+#include "stm32f4xx.h"
+
+/* returned by the level lookup functions when no level matches*/
+#define READY_QUEUE_NO_LEVEL READY_QUEUE_NUM_LEVELS
+
+/* weight of every level until OS_readyQueue_setLevelWeights() is called, i.e. all tasks are equally likely to be sampled*/
+#define READY_QUEUE_DEFAULT_LEVEL_WEIGHT 1
+
+//=============================================================================
+// Exported Functions
+//=============================================================================
+OS_readyQueue_t * new_readyQueue(void);
+uint32_t OS_readyQueue_levelOfPriority(uint32_t _priority);
+void OS_readyQueue_add(OS_readyQueue_t * _queue, OS_TCB_t * _task, uint32_t _priority);
+uint32_t OS_readyQueue_remove(OS_readyQueue_t * _queue, OS_TCB_t * _task);
+uint32_t OS_readyQueue_contains(OS_TCB_t * _task);
+uint32_t OS_readyQueue_highestLevel(OS_readyQueue_t * _queue);
+uint32_t OS_readyQueue_lowestLevel(OS_readyQueue_t * _queue);
+OS_TCB_t * OS_readyQueue_peekLevel(OS_readyQueue_t * _queue, uint32_t _level);
+OS_TCB_t * OS_readyQueue_rotateLevel(OS_readyQueue_t * _queue, uint32_t _level);
+void OS_readyQueue_setLevelWeights(OS_readyQueue_t * _queue, uint32_t (* _weightOfPriority)(uint32_t _priority));
+uint32_t OS_readyQueue_sampleLevel(OS_readyQueue_t * _queue, uint32_t _random);
+void DEBUG_printReadyQueue(OS_readyQueue_t * _queue);
+
+#endif //DOCETOS_READYQUEUE_H
@@ -7,6 +7,8 @@
 
 /*OS_init_semaphore initialises the semaphore to the desired values*/
 void OS_semaphore_init(OS_semaphore_t * _semaphore,uint32_t _initial_tokens, uint32_t _max_tokens){
+    OS_waitList_init(&_semaphore->waiters);
+    OS_waitList_init(&_semaphore->spaceWaiters);
     _semaphore->availableTokens = _initial_tokens;
     _semaphore->maxTokens = _max_tokens;
 }
@@ -32,12 +34,15 @@ uint32_t destroy_semaphore(OS_semaphore_t * _semaphore){
 
 /*  OS_semaphore_acquire_token removes a token from the semaphore
  *  -> blocks until another task releases a token if no token is available.
- *  -> if successful it notifies all tasks waiting on the semaphore.
+ *  -> if successful it wakes the highest priority task waiting to release a token.
+ *
+ *  NOTE: tasks waiting for a token are queued in waiters, tasks waiting for space in spaceWaiters. Keeping them apart means that
+ *  waking a single task always wakes one that can make progress.
  * */
 void OS_semaphore_acquire_token(OS_semaphore_t * _semaphore){
     uint32_t exclusiveAcessFailed;
     while(1){
-        uint32_t checkCode = OS_checkCode();
+        uint32_t checkCode = OS_checkCode(_semaphore);
         uint32_t tokens = (uint32_t)__LDREXW((uint32_t*) &(_semaphore->availableTokens));
         if(tokens > 0){
             tokens--;
@@ -54,17 +59,17 @@ void OS_semaphore_acquire_token(OS_semaphore_t * _semaphore){
         }
     }
 		/*some tasks might be waiting because they tried releasing a token when the semaphore was full.*/
-    OS_notify(_semaphore);
+    OS_notifyOne(&_semaphore->spaceWaiters,0);
 }
 
 /* OS_semaphore_release_token Places a token back into the semaphore.
  * -> blocks until another task removes a token if the semaphore already holds the maximum number of tokens
- * -> notifies all tasks waiting on this semaphore after successfully placeing token
+ * -> wakes the highest priority task waiting for a token after successfully placeing token
  * */
 void OS_semaphore_release_token(OS_semaphore_t * _semaphore){
     uint32_t exclusiveAcessFailed;
 		while(1){
-        uint32_t checkCode = OS_checkCode();
+        uint32_t checkCode = OS_checkCode(&_semaphore->spaceWaiters);
         uint32_t token_counter = (uint32_t)__LDREXW((uint32_t*) &(_semaphore->availableTokens));
         if(token_counter < _semaphore->maxTokens){
             token_counter++;
@@ -76,12 +81,12 @@ void OS_semaphore_release_token(OS_semaphore_t * _semaphore){
             }
         }else{
             //semaphore holds maximum number of tokens, wait for one to be taken
-            OS_wait(_semaphore,checkCode,0);
+            OS_wait(&_semaphore->spaceWaiters,checkCode,0);
             continue;
         }
     }
 		/*some tasks might be waiting because they tried acquire a token when the semaphore was empty.*/
-    OS_notify(_semaphore);
+    OS_notifyOne(_semaphore,0);
 }
 
 
@@ -4,6 +4,7 @@
 #include "structs.h"
 #include <stdio.h>
 #include "os_internal.h"
+#include "waitList.h"
 #include "os.h"
 
 void OS_semaphore_acquire_token(OS_semaphore_t * _semaphore);
@@ -0,0 +1,266 @@
+#include "timingWheel.h"
+
+//================================================================================
+// Internal Function Prototypes
+//================================================================================
+static uint32_t __placeNode(OS_timingWheel_t * _wheel, OS_timingWheelNode_t * _node);
+static void __unlinkNode(OS_timingWheel_t * _wheel, OS_timingWheelNode_t * _node);
+static OS_timingWheelNode_t * __detachSlot(OS_timingWheel_t * _wheel, uint32_t _slot);
+static void __cascadeSlot(OS_timingWheel_t * _wheel, uint32_t _slot, OS_timingWheelNode_t * * _expired);
+static void __expireSlot(OS_timingWheel_t * _wheel, uint32_t _slot, OS_timingWheelNode_t * * _expired);
+static void __pushExpired(OS_timingWheel_t * _wheel, OS_timingWheelNode_t * _node, OS_timingWheelNode_t * * _expired);
+static uint32_t __rotateRight(uint32_t _value, uint32_t _n);
+
+//================================================================================
+// Exported Functions
+//================================================================================
+
+/* Function that initialises a hierarchical timing wheel:
+-> the wheel has TIMING_WHEEL_NUM_LEVELS levels of TIMING_WHEEL_SLOTS_PER_LEVEL slots. A slot of level 0 covers one tick, a slot
+   of level 1 covers 32 ticks, a slot of level 2 covers 32*32 ticks and so on.
+-> nodes are keyed by the ABSOLUTE tick at which they expire. A node is placed into the lowest level that can hold its remaining
+   delay, whenever the wheel passes the start of a higher level slot the nodes of that slot are moved down into lower levels
+   ("cascade"). Every node is therefore touched at most once per level, insert/remove are O(1) and expiry is O(1) per tick.
+-> every level has a bitmap of its non empty slots, ticks without any work are skipped and the next event can be found without
+   looking at the nodes.
+-> all tick comparisons are wrap-safe, so a rollover of the tick counter needs no special treatment.
+*/
+OS_timingWheel_t * new_timingWheel(uint32_t _startTick){
+	OS_timingWheel_t * wheel = (OS_timingWheel_t *)OS_alloc(sizeof(OS_timingWheel_t)/4);
+	if(wheel == NULL){
+		printf("\r\nTIMING_WHEEL: ERROR cannot allocate required memory!\r\n");
+		ASSERT(0);
+		return NULL;
+	}
+	wheel->currentTick = _startTick;
+	wheel->numNodes = 0;
+	for(uint32_t level=0;level<TIMING_WHEEL_NUM_LEVELS;level++){
+		wheel->levelBitmap[level] = 0;
+	}
+	for(uint32_t slot=0;slot<TIMING_WHEEL_NUM_LEVELS * TIMING_WHEEL_SLOTS_PER_LEVEL;slot++){
+		wheel->slots[slot] = NULL;
+	}
+	return wheel;
+}
+
+/* prepares a node for use with a timing wheel, _content is the pointer the owner of the node wants to get back on expiry*/
+void OS_timingWheel_initNode(OS_timingWheelNode_t * _node, void * _content){
+	_node->next = NULL;
+	_node->prev = NULL;
+	_node->ptrToNodeContent = _content;
+	_node->wakeTick = 0;
+	_node->slot = TIMING_WHEEL_SLOT_NONE;
+}
+
+/* inserts _node into the wheel so that it expires once the tick _wakeTick has been reached.
+
+RETURNS:
+-> status_code: 1 if the node has been inserted, 0 if _wakeTick has already been reached (or lies more than
+   TIMING_WHEEL_MAX_DELAY ticks in the future) in which case the node is NOT inserted.*/
+uint32_t OS_timingWheel_insert(OS_timingWheel_t * _wheel, OS_timingWheelNode_t * _node, uint32_t _wakeTick){
+	if(_node->slot != TIMING_WHEEL_SLOT_NONE){
+		printf("\r\nTIMING_WHEEL: ERROR node %p is already in the wheel!\r\n",_node);
+		ASSERT(0);
+		return 0;
+	}
+	_node->wakeTick = _wakeTick;
+	if(!__placeNode(_wheel,_node)){
+		return 0;
+	}
+	_wheel->numNodes++;
+	return 1;
+}
+
+/* removes _node from the wheel before it expired.
+
+RETURNS: 1 if the node was in the wheel and has been removed, 0 otherwise*/
+uint32_t OS_timingWheel_remove(OS_timingWheel_t * _wheel, OS_timingWheelNode_t * _node){
+	if(_node->slot == TIMING_WHEEL_SLOT_NONE){
+		return 0;
+	}
+	__unlinkNode(_wheel,_node);
+	_wheel->numNodes--;
+	return 1;
+}
+
+/* RETURNS: 1 if the node is currently in a timing wheel, 0 otherwise*/
+uint32_t OS_timingWheel_contains(OS_timingWheelNode_t * _node){
+	return _node->slot != TIMING_WHEEL_SLOT_NONE;
+}
+
+/* advances the wheel up to (and including) the tick _now.
+
+RETURNS: a linked list (through node->next, NULL terminated) of all nodes that expired, NULL if no node expired. Expired nodes
+are no longer part of the wheel and can be inserted again straight away (read node->next BEFORE doing so).*/
+OS_timingWheelNode_t * OS_timingWheel_advance(OS_timingWheel_t * _wheel, uint32_t _now){
+	OS_timingWheelNode_t * expired = NULL;
+	while(OS_TICK_IS_BEFORE(_wheel->currentTick,_now)){
+		if(_wheel->numNodes == 0){
+			_wheel->currentTick = _now;// nothing to expire or cascade, jump straight to _now
+			break;
+		}
+		if(_wheel->levelBitmap[0] == 0){
+			/*level 0 is empty, nothing can expire before the next cascade so skip ahead to it*/
+			uint32_t ticksToBoundary = TIMING_WHEEL_SLOTS_PER_LEVEL - (_wheel->currentTick & (TIMING_WHEEL_SLOTS_PER_LEVEL - 1));
+			if(_now - _wheel->currentTick < ticksToBoundary){
+				_wheel->currentTick = _now;
+				break;
+			}
+			_wheel->currentTick += ticksToBoundary;
+		}else{
+			_wheel->currentTick++;
+		}
+		/*cascade higher levels whose slot starts at this tick (a level can only start a new slot if all lower levels did)*/
+		for(uint32_t level=1;level<TIMING_WHEEL_NUM_LEVELS;level++){
+			uint32_t shift = level * TIMING_WHEEL_SLOT_BITS;
+			if(_wheel->currentTick & ((1UL << shift) - 1)){
+				break;
+			}
+			uint32_t slotInLevel = (_wheel->currentTick >> shift) & (TIMING_WHEEL_SLOTS_PER_LEVEL - 1);
+			__cascadeSlot(_wheel,level * TIMING_WHEEL_SLOTS_PER_LEVEL + slotInLevel,&expired);
+		}
+		__expireSlot(_wheel,_wheel->currentTick & (TIMING_WHEEL_SLOTS_PER_LEVEL - 1),&expired);
+	}
+	return expired;
+}
+
+/* RETURNS: the number of ticks (counted from the last tick processed by the wheel) until the wheel next has work to do, UINT32_MAX if
+the wheel is empty. For nodes in higher levels this is the tick at which they cascade, which is never later than their wake tick, so
+the result is a safe lower bound for the next expiry.*/
+uint32_t OS_timingWheel_ticksUntilNextEvent(OS_timingWheel_t * _wheel){
+	if(_wheel->numNodes == 0){
+		return UINT32_MAX;
+	}
+	uint32_t ticksUntilEvent = UINT32_MAX;
+	for(uint32_t level=0;level<TIMING_WHEEL_NUM_LEVELS;level++){
+		uint32_t bitmap = _wheel->levelBitmap[level];
+		if(bitmap == 0){
+			continue;
+		}
+		uint32_t shift = level * TIMING_WHEEL_SLOT_BITS;
+		uint32_t currentSlot = (_wheel->currentTick >> shift) & (TIMING_WHEEL_SLOTS_PER_LEVEL - 1);
+		/*number of slots until the next non empty slot of this level (1..32, the current slot has already been processed)*/
+		uint32_t firstSlotToCheck = (currentSlot + 1) & (TIMING_WHEEL_SLOTS_PER_LEVEL - 1);
+		uint32_t slotsAhead = OS_COUNT_TRAILING_ZEROS(__rotateRight(bitmap,firstSlotToCheck)) + 1;
+		uint32_t ticks = (slotsAhead << shift) - (_wheel->currentTick & ((1UL << shift) - 1));
+		if(ticks < ticksUntilEvent){
+			ticksUntilEvent = ticks;
+		}
+	}
+	return ticksUntilEvent;
+}
+
+//================================================================================
+// Internal Functions
+//================================================================================
+
+/* links the node into the slot matching its remaining delay, RETURNS 0 (node not placed) if the node is already due*/
+static uint32_t __placeNode(OS_timingWheel_t * _wheel, OS_timingWheelNode_t * _node){
+	uint32_t delay = _node->wakeTick - _wheel->currentTick;
+	if(delay == 0 || delay > TIMING_WHEEL_MAX_DELAY){
+		return 0;// wake tick reached (or passed, wrap-safe)
+	}
+	uint32_t level = (31 - __CLZ(delay)) / TIMING_WHEEL_SLOT_BITS;
+	if(level >= TIMING_WHEEL_NUM_LEVELS){
+		/*delay exceeds the range of the wheel, park the node in the top level. It is revisited once per rotation of that level
+		and moves down as soon as its remaining delay fits*/
+		level = TIMING_WHEEL_NUM_LEVELS - 1;
+	}
+	uint32_t slotInLevel = (_node->wakeTick >> (level * TIMING_WHEEL_SLOT_BITS)) & (TIMING_WHEEL_SLOTS_PER_LEVEL - 1);
+	uint32_t slot = level * TIMING_WHEEL_SLOTS_PER_LEVEL + slotInLevel;
+	OS_timingWheelNode_t * head = _wheel->slots[slot];
+	_node->prev = NULL;
+	_node->next = head;
+	if(head){
+		head->prev = _node;
+	}
+	_wheel->slots[slot] = _node;
+	_wheel->levelBitmap[level] |= (1UL << slotInLevel);
+	_node->slot = slot;
+	return 1;
+}
+
+static void __unlinkNode(OS_timingWheel_t * _wheel, OS_timingWheelNode_t * _node){
+	uint32_t slot = _node->slot;
+	if(_node->prev){
+		_node->prev->next = _node->next;
+	}else{
+		_wheel->slots[slot] = _node->next;
+	}
+	if(_node->next){
+		_node->next->prev = _node->prev;
+	}
+	if(_wheel->slots[slot] == NULL){
+		_wheel->levelBitmap[slot >> TIMING_WHEEL_SLOT_BITS] &= ~(1UL << (slot & (TIMING_WHEEL_SLOTS_PER_LEVEL - 1)));
+	}
+	_node->next = NULL;
+	_node->prev = NULL;
+	_node->slot = TIMING_WHEEL_SLOT_NONE;
+}
+
+/* empties the slot and returns the list of nodes it held*/
+static OS_timingWheelNode_t * __detachSlot(OS_timingWheel_t * _wheel, uint32_t _slot){
+	OS_timingWheelNode_t * list = _wheel->slots[_slot];
+	_wheel->slots[_slot] = NULL;
+	_wheel->levelBitmap[_slot >> TIMING_WHEEL_SLOT_BITS] &= ~(1UL << (_slot & (TIMING_WHEEL_SLOTS_PER_LEVEL - 1)));
+	return list;
+}
+
+/* moves all nodes of a higher level slot into the lower levels (or onto the expired list if they are due)*/
+static void __cascadeSlot(OS_timingWheel_t * _wheel, uint32_t _slot, OS_timingWheelNode_t * * _expired){
+	OS_timingWheelNode_t * node = __detachSlot(_wheel,_slot);
+	while(node){
+		OS_timingWheelNode_t * next = node->next;
+		node->slot = TIMING_WHEEL_SLOT_NONE;
+		if(!__placeNode(_wheel,node)){
+			__pushExpired(_wheel,node,_expired);
+		}
+		node = next;
+	}
+}
+
+/* moves all nodes of a level 0 slot onto the expired list*/
+static void __expireSlot(OS_timingWheel_t * _wheel, uint32_t _slot, OS_timingWheelNode_t * * _expired){
+	OS_timingWheelNode_t * node = __detachSlot(_wheel,_slot);
+	while(node){
+		OS_timingWheelNode_t * next = node->next;
+		__pushExpired(_wheel,node,_expired);
+		node = next;
+	}
+}
+
+static void __pushExpired(OS_timingWheel_t * _wheel, OS_timingWheelNode_t * _node, OS_timingWheelNode_t * * _expired){
+	_node->slot = TIMING_WHEEL_SLOT_NONE;
+	_node->prev = NULL;
+	_node->next = *_expired;
+	*_expired = _node;
+	_wheel->numNodes--;
+}
+
+static uint32_t __rotateRight(uint32_t _value, uint32_t _n){
+	if(_n == 0){
+		return _value;
+	}
+	return (_value >> _n) | (_value << (32 - _n));
+}
+
+//================================================================================
+// DEBUG FUNCTIONS
+//================================================================================
+
+void DEBUG_printTimingWheel(OS_timingWheel_t * _wheel){
+	printf("----------------------------------------------------------------------------------------------------------------\r\n");
+	printf("GENERAL INFO:\r\n");
+	printf("current tick:%-40d\r\n",_wheel->currentTick);
+	printf("number of nodes:%-40d\r\n",_wheel->numNodes);
+	printf("\r\nTIMING WHEEL CONTENTS:\r\n");
+	printf("%-20s%-20s%-20s%-20s\r\n","[LEVEL]","[SLOT]","[WAKE_TICK]","[CONTENT_PTR]");
+	for(uint32_t slot=0;slot<TIMING_WHEEL_NUM_LEVELS * TIMING_WHEEL_SLOTS_PER_LEVEL;slot++){
+		OS_timingWheelNode_t * node = _wheel->slots[slot];
+		while(node){
+			printf("%-20d%-20d%-20d%-20p\r\n",slot >> TIMING_WHEEL_SLOT_BITS,slot & (TIMING_WHEEL_SLOTS_PER_LEVEL - 1),node->wakeTick,node->ptrToNodeContent);
+			node = node->next;
+		}
+	}
+	printf("----------------------------------------------------------------------------------------------------------------\n\r\n");
+}
@@ -0,0 +1,27 @@
+#ifndef DOCETOS_TIMINGWHEEL_H
+#define DOCETOS_TIMINGWHEEL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "../OS/debug.h"
+#include "structs.h"
+#include "os.h"
+#include "stm32f4xx.h"
+
+/* the largest delay (in ticks) that can be inserted into the wheel. Wake ticks are compared wrap-safe, so they
+ * must lie less than 2^31 ticks in the future.*/
+#define TIMING_WHEEL_MAX_DELAY 0x7FFFFFFFUL
+
+//=============================================================================
+// Exported Functions
+//=============================================================================
+OS_timingWheel_t * new_timingWheel(uint32_t _startTick);
+void OS_timingWheel_initNode(OS_timingWheelNode_t * _node, void * _content);
+uint32_t OS_timingWheel_insert(OS_timingWheel_t * _wheel, OS_timingWheelNode_t * _node, uint32_t _wakeTick);
+uint32_t OS_timingWheel_remove(OS_timingWheel_t * _wheel, OS_timingWheelNode_t * _node);
+uint32_t OS_timingWheel_contains(OS_timingWheelNode_t * _node);
+OS_timingWheelNode_t * OS_timingWheel_advance(OS_timingWheel_t * _wheel, uint32_t _now);
+uint32_t OS_timingWheel_ticksUntilNextEvent(OS_timingWheel_t * _wheel);
+void DEBUG_printTimingWheel(OS_timingWheel_t * _wheel);
+
+#endif //DOCETOS_TIMINGWHEEL_H
@@ -0,0 +1,120 @@
+#include "waitList.h"
+
+//================================================================================
+// Exported Functions
+//================================================================================
+
+/* Function that initialises a wait list:
+-> the wait list is a doubly linked list whose links are stored inside the TCBs themselves, so a task can start and stop waiting
+   without allocating memory or hashing anything, and the list never runs out of capacity.
+-> the list does not allocate anything itself. Every object tasks can wait on (mutex, semaphore) embeds one as its FIRST member, so
+   the scheduler finds the waiters of an object straight from the wait reason without searching or hashing.
+*/
+void OS_waitList_init(OS_waitList_t * _list){
+	_list->head = NULL;
+	_list->tail = NULL;
+	_list->numTasks = 0;
+	_list->sequence = 0;
+}
+
+/* inserts a task into the list ordered by effective priority (highest first, i.e. lowest value) and records the reason it waits for
+in its TCB. Tasks of equal priority are kept in the order they started waiting, so the head of the list is always the task that should
+be woken first.*/
+void OS_waitList_insert(OS_waitList_t * _list, OS_TCB_t * _task, void * _reason){
+	uint32_t priority = TASK_EFFECTIVE_PRIORITY(_task);
+	/*searching from the tail makes queueing up behind tasks of equal or higher priority (the common case) O(1)*/
+	OS_TCB_t * prev = _list->tail;
+	while(prev && TASK_EFFECTIVE_PRIORITY(prev) > priority){
+		prev = (OS_TCB_t *)prev->waitPrev;
+	}
+	OS_TCB_t * next = prev ? (OS_TCB_t *)prev->waitNext : _list->head;
+	_task->waitReason = _reason;
+	_task->waitPrev = prev;
+	_task->waitNext = next;
+	if(prev){
+		prev->waitNext = _task;
+	}else{
+		_list->head = _task;
+	}
+	if(next){
+		next->waitPrev = _task;
+	}else{
+		_list->tail = _task;
+	}
+	_list->numTasks++;
+}
+
+/* unlinks a task from the list and clears its wait reason. The task MUST be linked into _list.*/
+void OS_waitList_remove(OS_waitList_t * _list, OS_TCB_t * _task){
+	OS_TCB_t * prev = (OS_TCB_t *)_task->waitPrev;
+	OS_TCB_t * next = (OS_TCB_t *)_task->waitNext;
+	if(prev){
+		prev->waitNext = next;
+	}else{
+		_list->head = next;
+	}
+	if(next){
+		next->waitPrev = prev;
+	}else{
+		_list->tail = prev;
+	}
+	_task->waitNext = NULL;
+	_task->waitPrev = NULL;
+	_task->waitReason = NULL;
+	_list->numTasks--;
+}
+
+/* moves a task that is linked into _list to the place its current effective priority belongs to. Needs to be called whenever the
+priority of a waiting task changes (e.g. through priority inheritance).*/
+void OS_waitList_reposition(OS_waitList_t * _list, OS_TCB_t * _task){
+	void * reason = _task->waitReason;
+	OS_waitList_remove(_list,_task);
+	OS_waitList_insert(_list,_task,reason);
+}
+
+/* RETURNS: the highest priority waiter that is not suspended (see OS_suspend), NULL if there is none. A suspended waiter keeps its place
+in the list, but handing it a notification would lose the notification until the task is resumed. Only suspended waiters in front of
+the result are skipped, so this is O(1) unless tasks at the head of the list are suspended.*/
+OS_TCB_t * OS_waitList_peekNotSuspended(OS_waitList_t * _list){
+	OS_TCB_t * task = _list->head;
+	while(task && (task->state & TASK_STATE_SUSPENDED)){
+		task = (OS_TCB_t *)task->waitNext;
+	}
+	return task;
+}
+
+/* takes a task out of the list because what it waited for happened: it is unlinked and its WAIT state and the mutex it waited on are
+cleared. Making the task ready again is up to the scheduler. The task MUST be linked into _list.*/
+void OS_waitList_wake(OS_waitList_t * _list, OS_TCB_t * _task){
+	OS_waitList_remove(_list,_task);
+	_task->waitingOnMutex = NULL;
+	_task->state &= ~TASK_STATE_WAIT;
+}
+
+/* wakes the highest priority waiter that is not suspended (see OS_waitList_peekNotSuspended), the remaining waiters keep waiting.
+
+RETURNS: the woken task, NULL if there is none*/
+OS_TCB_t * OS_waitList_wakeOne(OS_waitList_t * _list){
+	OS_TCB_t * task = OS_waitList_peekNotSuspended(_list);
+	if(task){
+		OS_waitList_wake(_list,task);
+	}
+	return task;
+}
+
+//================================================================================
+// Internal Functions
+//================================================================================
+
+
+//================================================================================
+// DEBUG FUNCTIONS
+//================================================================================
+
+void DEBUG_printWaitList(OS_waitList_t * _list){
+	printf("\r\n--------------------------------------------------------------------------\r\n");
+	printf("WAIT LIST %p (%d tasks):\r\n",_list,_list->numTasks);
+	for(OS_TCB_t * task = _list->head; task; task = (OS_TCB_t *)task->waitNext){
+		printf("\ttask %p (state 0x%08x) is waiting for %p\r\n",task,task->state,task->waitReason);
+	}
+}
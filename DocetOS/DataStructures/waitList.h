@@ -0,0 +1,22 @@
+#ifndef DOCETOS_WAITLIST_H
+#define DOCETOS_WAITLIST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "../OS/debug.h"
+#include "structs.h"
+#include "os.h"
+
+//=============================================================================
+// Exported Functions
+//=============================================================================
+void OS_waitList_init(OS_waitList_t * _list);
+void OS_waitList_insert(OS_waitList_t * _list, OS_TCB_t * _task, void * _reason);
+void OS_waitList_remove(OS_waitList_t * _list, OS_TCB_t * _task);
+void OS_waitList_reposition(OS_waitList_t * _list, OS_TCB_t * _task);
+OS_TCB_t * OS_waitList_peekNotSuspended(OS_waitList_t * _list);
+void OS_waitList_wake(OS_waitList_t * _list, OS_TCB_t * _task);
+OS_TCB_t * OS_waitList_wakeOne(OS_waitList_t * _list);
+void DEBUG_printWaitList(OS_waitList_t * _list);
+
+#endif //DOCETOS_WAITLIST_H
@@ -0,0 +1,358 @@
+#include "cyclicScheduler.h"
+
+//=============================================================================
+// vars
+//=============================================================================
+
+//SCHEDULE TABLE
+/*table
+static schedule set with OS_cyclic_setScheduleTable(), owned by the caller. The slots are dispatched in table order, one major frame
+after the other, so finding the next slot is a matter of incrementing nextSlot. There is no ready structure at all: at any tick the
+only task that may run is the task of the active slot.*/
+static OS_cyclicSlot_t const * table = NULL;
+static uint32_t numSlots = 0;
+static uint32_t majorFrame = 0;
+static uint32_t frameStart = 0; // tick at which the current major frame started
+static uint32_t nextSlot = 0; // index of the slot that is dispatched next
+static uint32_t nextDispatchTick = 0; // tick at which nextSlot is dispatched
+/*slot whose task currently owns the cpu (NULL between slots or once its job is done), and the tick at which its budget runs out*/
+static OS_cyclicSlot_t const * activeSlot = NULL;
+static uint32_t slotEndTick = 0;
+static uint32_t isJobDone = 0;
+
+//WAIT RELATED
+/*waiting tasks are queued in the wait list embedded in the object they wait for (see waitList.c).*/
+
+//SLEEP RELATED
+/*a sleeping task keeps its wake tick in its sleepNode but is not put into a timing wheel. It can only run in its own slots anyway, so
+the scheduler compares the wake tick when the slot of the task is active (see cyclicScheduler_scheduler).*/
+
+//EXITED TASKS
+/*tasks that exited whilst the schedule table still refers to them, linked through their data field. Their memory is reclaimed once a
+new table that no longer refers to them is set (see OS_cyclic_setScheduleTable).*/
+static OS_TCB_t * exitedTasks = NULL;
+
+//STATISTICS
+static uint32_t totalOverruns = 0;
+
+//=============================================================================
+// prototypes
+//=============================================================================
+
+//svc accessible
+static OS_TCB_t const * cyclicScheduler_scheduler(void);
+static void cyclicScheduler_addTask(OS_TCB_t * const tcb,uint32_t task_priority);
+static void cyclicScheduler_taskExit(OS_TCB_t * const tcb);
+static void cyclicScheduler_waitCallback(void * const _reason, uint32_t checkCode,uint32_t _isReasonMutex);
+static void cyclicScheduler_notifyCallback(void * const reason);
+static void cyclicScheduler_notifyOneCallback(void * const reason, uint32_t _isReasonMutex);
+static void cyclicScheduler_sleepCallback(OS_TCB_t * const tcb,uint32_t min_sleep_duration);
+static void cyclicScheduler_resourceAcquired(OS_mutex_t * _acquiredMutex);
+static uint32_t cyclicScheduler_ticksUntilNextWakeup(void);
+static void cyclicScheduler_periodComplete(OS_TCB_t * const tcb);
+
+//internal
+static void __closeSlot(void);
+static uint32_t __isInTable(OS_TCB_t * task);
+static void __makeWaiterReady(OS_TCB_t * task);
+
+//=============================================================================
+// init
+//=============================================================================
+
+/*scheduler struct init*/
+OS_Scheduler_t const cyclicScheduler = {
+		.preemptive = 1,
+		.init_callback = initialize_cyclicScheduler,
+		.scheduler_callback = cyclicScheduler_scheduler,
+		.addtask_callback = cyclicScheduler_addTask,
+		.taskexit_callback = cyclicScheduler_taskExit,
+		.wait_callback = cyclicScheduler_waitCallback,
+		.notify_callback = cyclicScheduler_notifyCallback,
+		.notifyOne_callback = cyclicScheduler_notifyOneCallback,
+		.sleep_callback = cyclicScheduler_sleepCallback,
+		.resourceAcquired_callback = cyclicScheduler_resourceAcquired,
+		.ticksUntilNextWakeup_callback = cyclicScheduler_ticksUntilNextWakeup,
+		.periodComplete_callback = cyclicScheduler_periodComplete
+};
+
+void initialize_cyclicScheduler(uint32_t _initialTaskCapacity){
+	/*nothing is allocated, the schedule table is provided by the user and tasks are only referenced from there*/
+	table = NULL;
+	activeSlot = NULL;
+	exitedTasks = NULL;
+	totalOverruns = 0;
+}
+
+//=============================================================================
+// SCHEDULER FUNCTION
+//=============================================================================
+/* Dispatches the task of the slot that is due according to the schedule table and runs it until its job is done or its budget runs out.
+Runs on every tick, but only does a couple of tick comparisons unless a slot starts or ends.
+*/
+static OS_TCB_t const * cyclicScheduler_scheduler(void){
+	OS_TCB_t * currentTaskTCB = OS_currentTCB();
+	uint32_t now = OS_elapsedTicks();
+
+	OS_reclaimCompletedTasks();// tasks whose memory could not be freed when the table was replaced
+
+	/*only OS_waitForNextPeriod() ends the job of a slot (it sets isJobDone). A plain yield, which mutex release, OS_alloc/OS_free and the
+	channels do internally, keeps the job running since there is no other task the slot could be given to.*/
+	currentTaskTCB->state &= ~TASK_STATE_YIELD;// reset so task has chance of running after next task switch
+	if(isJobDone || (activeSlot && !OS_TICK_IS_BEFORE(now,slotEndTick))){
+		__closeSlot();// job done or budget used up
+	}
+
+	/*dispatch the slot that is due. Normally this is at most one slot per tick, the loop only catches up should the scheduler have run
+	late (e.g. interrupts masked for a long time), in which case slots that ended in the meantime count as overrun.*/
+	while(table && !OS_TICK_IS_BEFORE(now,nextDispatchTick)){
+		__closeSlot();// the next slot preempts the job of the previous one
+		activeSlot = &table[nextSlot];
+		slotEndTick = nextDispatchTick + activeSlot->budget;
+		isJobDone = 0;
+		if(++nextSlot == numSlots){
+			nextSlot = 0;
+			frameStart += majorFrame;
+		}
+		nextDispatchTick = frameStart + table[nextSlot].offset;
+		if(!OS_TICK_IS_BEFORE(now,slotEndTick)){
+			__closeSlot();// missed entirely
+		}
+	}
+
+	if(activeSlot == NULL){
+		return OS_idleTCB_p;// between slots
+	}
+	OS_TCB_t * task = activeSlot->task;
+	if((task->state & TASK_STATE_SLEEP) && !OS_TICK_IS_BEFORE(now,task->sleepNode.wakeTick)){
+		task->state &= ~TASK_STATE_SLEEP;
+	}
+	if(!(task->state & TASK_STATE_SCHEDULED) || (task->state & (TASK_STATE_WAIT | TASK_STATE_SLEEP | TASK_STATE_EXIT))){
+		return OS_idleTCB_p;// the slot stays open, the task runs should it become ready before the slot ends
+	}
+	return task;
+}
+
+//=============================================================================
+// Task related function definitions
+//=============================================================================
+
+void OS_cyclic_setScheduleTable(OS_cyclicSlot_t const * _table, uint32_t _numSlots, uint32_t _majorFrame){
+	if(_table == NULL || _numSlots == 0 || _majorFrame == 0){
+		printf("\r\nCYCLIC SCHEDULER: ERROR, empty schedule table!\r\n");
+		ASSERT(0);
+		return;
+	}
+	for(uint32_t i=0;i<_numSlots;i++){
+		/*end of the gap the slot has to fit into: the offset of the next slot, for the last slot the first slot of the next frame*/
+		uint32_t nextOffset = (i + 1 < _numSlots) ? _table[i + 1].offset : _table[0].offset + _majorFrame;
+		if(_table[i].task == NULL || _table[i].budget == 0 || _table[i].offset >= _majorFrame || _table[i].offset >= nextOffset
+				|| _table[i].budget > nextOffset - _table[i].offset){
+			printf("\r\nCYCLIC SCHEDULER: ERROR, invalid slot %d (offset %d, task %p, budget %d) in schedule table with major frame %d!\r\n",
+						 i,_table[i].offset,_table[i].task,_table[i].budget,_majorFrame);
+			ASSERT(0);
+			return;
+		}
+	}
+	__disable_irq();// the scheduler reads the table on every tick
+	table = _table;
+	numSlots = _numSlots;
+	majorFrame = _majorFrame;
+	frameStart = OS_elapsedTicks();
+	nextSlot = 0;
+	nextDispatchTick = frameStart + _table[0].offset;
+	activeSlot = NULL;
+	/*exited tasks the new table no longer refers to can be reclaimed*/
+	OS_TCB_t * unreferencedTasks = NULL;
+	OS_TCB_t ** link = &exitedTasks;
+	while(*link){
+		OS_TCB_t * task = *link;
+		if(__isInTable(task)){
+			link = (OS_TCB_t **)&task->data;
+		}else{
+			*link = (OS_TCB_t *)task->data;
+			task->data = (uint32_t)unreferencedTasks;
+			unreferencedTasks = task;
+		}
+	}
+	__enable_irq();
+	while(unreferencedTasks){
+		OS_TCB_t * task = unreferencedTasks;
+		unreferencedTasks = (OS_TCB_t *)task->data;
+		OS_reclaimTask(task);
+	}
+}
+
+/* Adds a task to the scheduler. The task only runs in the slots of the schedule table that refer to it, the priority is only used to
+order it in wait lists.
+*/
+static void cyclicScheduler_addTask(OS_TCB_t * const tcb,uint32_t task_priority){
+	if(tcb == NULL){
+		printf("\r\nCYCLIC SCHEDULER: ERROR, attempt to add null pointer tcb to scheduler!\r\n");
+		ASSERT(0);
+		return;
+	}else if(tcb->state != 0){
+		printf("\r\nCYCLIC SCHEDULER: ERROR, cannot add tasks that have a state other than 0x00 to scheduler! The task you tried to add has state 0x%08x\r\n",tcb->state);
+		ASSERT(0);
+		return;
+	}else if(task_priority == 0){
+		printf("\r\nCYCLIC SCHEDULER: ERROR, tried to add task with priority 0, lowest allowed priority is 1!\r\n");
+		ASSERT(0);
+		return;
+	}
+	tcb->state = TASK_STATE_SCHEDULED;
+	tcb->priority = task_priority;
+	tcb->deadlineMisses = 0;
+}
+
+/* This function is automatically called when a task exits. Its slots stay in the table and are left idle from now on.
+
+NOTE: the memory of the task cannot be reclaimed whilst the schedule table still refers to it, it is reclaimed once a table without the
+task is set (a joinable task is freed by OS_join() regardless, so only join a task once the table no longer refers to it). Tasks of a
+static schedule are not expected to exit.
+
+NOTE: this function should NEVER be called manually
+*/
+static void cyclicScheduler_taskExit(OS_TCB_t * const tcb){
+	tcb->state |= TASK_STATE_EXIT;
+	if(!tcb->joinable){
+		tcb->data = (uint32_t)exitedTasks;
+		exitedTasks = tcb;
+	}
+}
+
+/* Called through OS_waitForNextPeriod() when the task is done with the job of its slot. The rest of the slot is left idle, the task
+runs again in its next slot.*/
+static void cyclicScheduler_periodComplete(OS_TCB_t * const tcb){
+	if(activeSlot && activeSlot->task == tcb){
+		isJobDone = 1;
+	}
+}
+
+//=============================================================================
+// wait, notify and sleep
+//=============================================================================
+
+/*Marks the current task as waiting and queues it in the wait list of the object it waits for. The slot of the task stays open, if the
+task is notified before the slot ends it continues straight away.
+
+NOTE: there is no priority inheritance, a task that waits on a mutex held by the task of another slot waits until that slot released
+it. Keep critical sections shared between slots short.*/
+static void cyclicScheduler_waitCallback(void * const _reason, uint32_t checkCode,uint32_t _isReasonMutex){
+	if (checkCode != OS_checkCode(_reason)){
+		return;//checkcode mismatch, notify called during function that uses wait
+	}
+	OS_TCB_t * currentTCB = OS_currentTCB();
+	OS_waitList_insert((OS_waitList_t *)_reason,currentTCB,_reason);
+	currentTCB->state |= TASK_STATE_WAIT;
+	if(_isReasonMutex){
+		currentTCB->waitingOnMutex = _reason;
+	}
+}
+
+static void cyclicScheduler_notifyCallback(void * const reason){
+	/*make all the tasks that are waiting for the given reason ready again*/
+	OS_waitList_t * waiters = (OS_waitList_t *)reason;
+	while(waiters->head){
+		OS_TCB_t * task = waiters->head;
+		OS_waitList_wake(waiters,task);
+		__makeWaiterReady(task);
+	}
+	OS_mutex_unregisterAcquired(OS_currentTCB(),reason);
+}
+
+/*wakes only the highest priority waiter and hands a released mutex to it directly (see OS_mutex_handOff)*/
+static void cyclicScheduler_notifyOneCallback(void * const reason, uint32_t _isReasonMutex){
+	OS_TCB_t * task;
+	if(_isReasonMutex){
+		task = OS_mutex_handOff((OS_mutex_t *)reason);
+	}else{
+		task = OS_waitList_wakeOne((OS_waitList_t *)reason);
+	}
+	if(task){
+		__makeWaiterReady(task);
+	}
+	OS_mutex_unregisterAcquired(OS_currentTCB(),reason);
+}
+
+/* records the wake tick of the task, see SLEEP RELATED above*/
+static void cyclicScheduler_sleepCallback(OS_TCB_t * const tcb,uint32_t min_sleep_duration){
+	if(min_sleep_duration == 0){
+		return;
+	}
+	tcb->sleepNode.wakeTick = OS_elapsedTicks() + min_sleep_duration;
+	tcb->state |= TASK_STATE_SLEEP;
+}
+
+static void cyclicScheduler_resourceAcquired(OS_mutex_t * _acquiredMutex){
+	OS_mutex_registerAcquired(OS_currentTCB(),_acquiredMutex);// no priority inheritance, the list is only kept up to date
+}
+
+/* Used by the OS for tickless idle: the cpu is only idle between slots or whilst the task of the active slot is blocked, so the next
+wakeup is the next dispatch or the wake tick of the sleeping task of the active slot, whichever comes first.
+
+RETURNS: number of ticks until the next wakeup (never too late, might be early), UINT32_MAX if no schedule table is set*/
+static uint32_t cyclicScheduler_ticksUntilNextWakeup(void){
+	if(table == NULL){
+		return UINT32_MAX;
+	}
+	uint32_t now = OS_elapsedTicks();
+	uint32_t ticks = OS_TICK_IS_BEFORE(now,nextDispatchTick) ? nextDispatchTick - now : 0;
+	if(activeSlot && (activeSlot->task->state & TASK_STATE_SLEEP)){
+		uint32_t wakeTick = activeSlot->task->sleepNode.wakeTick;
+		uint32_t ticksUntilWake = OS_TICK_IS_BEFORE(now,wakeTick) ? wakeTick - now : 0;
+		if(ticksUntilWake < ticks){
+			ticks = ticksUntilWake;
+		}
+	}
+	return ticks;
+}
+
+//=============================================================================
+// Internal utility functions
+//=============================================================================
+
+/* ends the active slot. A slot that ends before its task finished the job counts as an overrun of the task (unless the task exited),
+the task continues the same job in its next slot.*/
+static void __closeSlot(void){
+	if(activeSlot == NULL){
+		return;
+	}
+	OS_TCB_t * task = activeSlot->task;
+	if(!isJobDone && !(task->state & TASK_STATE_EXIT)){
+		task->deadlineMisses++;
+		totalOverruns++;
+	}
+	activeSlot = NULL;
+	isJobDone = 0;
+}
+
+/* RETURNS: 1 if a slot of the current schedule table refers to the task, 0 otherwise*/
+static uint32_t __isInTable(OS_TCB_t * task){
+	for(uint32_t i=0;i<numSlots;i++){
+		if(table[i].task == task){
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* called for a task that has just been taken out of its wait list (see OS_waitList_wake). If the slot of the task is active it is
+switched to straight away.*/
+static void __makeWaiterReady(OS_TCB_t * task){
+	if(activeSlot && activeSlot->task == task){
+		SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+	}
+}
+
+//=============================================================================
+// Externally accessible utility functions
+//=============================================================================
+
+uint32_t OS_cyclic_getOverruns(OS_TCB_t * _task){
+	return _task->deadlineMisses;
+}
+
+uint32_t OS_cyclic_getTotalOverruns(void){
+	return totalOverruns;
+}
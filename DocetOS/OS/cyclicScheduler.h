@@ -0,0 +1,27 @@
+#ifndef DOCETOS_cyclicScheduler_H
+#define DOCETOS_cyclicScheduler_H
+
+#include "os.h"
+#include "stm32f4xx.h"
+#include "structs.h"
+#include "../DataStructures/mutex.h"
+#include "../DataStructures/waitList.h"
+#include "memcluster.h"
+
+void initialize_cyclicScheduler(uint32_t _initialTaskCapacity);
+extern OS_Scheduler_t const cyclicScheduler;
+
+/* Sets the static schedule: every majorFrame ticks the slots of table are dispatched in order, slot i at table[i].offset ticks into the
+ * frame. Offsets have to be strictly increasing and below majorFrame, and a slot has to end (offset + budget) before the next slot starts
+ * (the last one before the first slot of the next frame). The table is not copied, it has to stay valid for as long as the scheduler runs.
+ * Tasks are created with OS_initialiseTCB() and added with OS_addTask() as with any other scheduler, a task may appear in several
+ * slots. Call after OS_init(), the first frame starts at the tick the table is set. Exited tasks the new table no longer refers to are
+ * reclaimed.*/
+void OS_cyclic_setScheduleTable(OS_cyclicSlot_t const * _table, uint32_t _numSlots, uint32_t _majorFrame);
+
+/*overrun counters, a slot that ends before its task is done with its job (signalled with OS_waitForNextPeriod(), OS_yield() does not end
+the job) counts as one overrun*/
+uint32_t OS_cyclic_getOverruns(OS_TCB_t * _task);
+uint32_t OS_cyclic_getTotalOverruns(void);
+
+#endif //DOCETOS_cyclicScheduler_H
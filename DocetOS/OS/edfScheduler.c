@@ -0,0 +1,481 @@
+#include "edfScheduler.h"
+
+//=============================================================================
+// vars
+//=============================================================================
+
+//READY STRUCTURES
+/*readyHeap
+holds every periodic task that has a released job that is not done yet, except the one that is currently running, ordered by the absolute
+deadline of the job. Deadlines are stored relative to deadlineBase so that they can be compared as plain unsigned values.*/
+static OS_minHeap_t * readyHeap;
+static uint32_t deadlineBase = 0;
+/*backgroundQueue
+holds the ready background (non periodic) tasks. They only run when the readyHeap is empty, and take turns by priority level.*/
+static OS_readyQueue_t * backgroundQueue;
+/*task that was selected last (NULL if the idle task was selected). It is in neither of the two structures above while it runs.*/
+static OS_TCB_t * runningTask = NULL;
+static uint32_t runningTaskStartTick = 0;
+
+//WAIT RELATED
+/*waiting tasks are queued in the wait list embedded in the object they wait for (see waitList.c).*/
+
+//SLEEP RELATED
+/*sleepWheel
+holds sleeping tasks as well as periodic tasks whose job is done and that wait for the release of their next job.*/
+static OS_timingWheel_t * sleepWheel;
+
+static uint32_t numTasks = 0; /*tasks that have been added and not yet reclaimed, the readyHeap is kept large enough to hold all of them*/
+
+//STATISTICS
+static uint32_t totalUtilization = 0; // sum of wcet/period of all periodic tasks, in 1/EDF_SCHEDULER_UTILIZATION_ONE
+static uint32_t totalDeadlineMisses = 0;
+
+//=============================================================================
+// prototypes
+//=============================================================================
+
+//svc accessible
+static OS_TCB_t const * edfScheduler_scheduler(void);
+static void edfScheduler_addTask(OS_TCB_t * const tcb,uint32_t task_priority);
+static void edfScheduler_taskExit(OS_TCB_t * const tcb);
+static void edfScheduler_waitCallback(void * const _reason, uint32_t checkCode,uint32_t _isReasonMutex);
+static void edfScheduler_notifyCallback(void * const reason);
+static void edfScheduler_notifyOneCallback(void * const reason, uint32_t _isReasonMutex);
+static void edfScheduler_sleepCallback(OS_TCB_t * const tcb,uint32_t min_sleep_duration);
+static void edfScheduler_resourceAcquired(OS_mutex_t * _acquiredMutex);
+static uint32_t edfScheduler_ticksUntilNextWakeup(void);
+static void edfScheduler_periodComplete(OS_TCB_t * const tcb);
+static uint32_t edfScheduler_setPriority(OS_TCB_t * const tcb, uint32_t task_priority);
+
+//internal
+static uint32_t __utilizationOf(OS_TCB_t * task);
+static uint32_t __deadlineKey(OS_TCB_t * task);
+static uint32_t __shouldPreempt(OS_TCB_t * task);
+static void __releaseJob(OS_TCB_t * task);
+static void __makeReady(OS_TCB_t * task);
+static void __putBackRunningTask(void);
+static void __rebaseDeadlines(void);
+static void __reclaimTask(OS_TCB_t * task);
+static uint32_t __reserveReadyHeapCapacity(uint32_t _numTasks);
+static void __wakeTask(OS_TCB_t * task);
+
+//debug
+static void DEBUG_schedulerState(void);
+
+//=============================================================================
+// init
+//=============================================================================
+
+/*scheduler struct init*/
+OS_Scheduler_t const edfScheduler = {
+		.preemptive = 1,
+		.init_callback = initialize_edfScheduler,
+		.scheduler_callback = edfScheduler_scheduler,
+		.addtask_callback = edfScheduler_addTask,
+		.taskexit_callback = edfScheduler_taskExit,
+		.wait_callback = edfScheduler_waitCallback,
+		.notify_callback = edfScheduler_notifyCallback,
+		.notifyOne_callback = edfScheduler_notifyOneCallback,
+		.sleep_callback = edfScheduler_sleepCallback,
+		.resourceAcquired_callback = edfScheduler_resourceAcquired,
+		.ticksUntilNextWakeup_callback = edfScheduler_ticksUntilNextWakeup,
+		.periodComplete_callback = edfScheduler_periodComplete,
+		.setPriority_callback = edfScheduler_setPriority
+};
+
+void initialize_edfScheduler(uint32_t _initialTaskCapacity){
+	/*a periodic task that cannot be put back into the readyHeap would be lost. The readyHeap starts out with room for _initialTaskCapacity
+	tasks and grows whenever a task is added that would not fit (see __reserveReadyHeapCapacity)*/
+	readyHeap = new_heap(_initialTaskCapacity,0);
+	OS_heap_setFifoTies(readyHeap,EDF_SCHEDULER_FIFO_TIES);
+	backgroundQueue = new_readyQueue();
+	sleepWheel = new_timingWheel(OS_elapsedTicks());
+	deadlineBase = OS_elapsedTicks();
+}
+
+//=============================================================================
+// SCHEDULER FUNCTION
+//=============================================================================
+/* Runs the ready job with the earliest absolute deadline. A running job is preempted as soon as a job with an earlier deadline is released.
+Background tasks only run when no job is ready.
+*/
+static OS_TCB_t const * edfScheduler_scheduler(void){
+	OS_TCB_t * currentTaskTCB = OS_currentTCB();
+
+	/*release the jobs and wake the tasks whose tick has been reached. This runs on every tick before the running task is considered, so a
+	released job with an earlier deadline preempts the running job on the tick it is released at (THIS MUST RUN BEFORE __shouldPreempt!
+	DONT MOVE THIS!)*/
+	OS_timingWheelNode_t * wokenNode = OS_timingWheel_advance(sleepWheel,OS_elapsedTicks());
+	while(wokenNode){
+		OS_TCB_t * wokenTask = (OS_TCB_t *)wokenNode->ptrToNodeContent;
+		wokenNode = wokenNode->next;
+		__wakeTask(wokenTask);
+	}
+	if(OS_elapsedTicks() - deadlineBase >= EDF_SCHEDULER_REBASE_THRESHOLD){
+		__rebaseDeadlines();
+	}
+
+	/*check if task has yielded, is waiting, sleeping or has exited. If not then keep running it unless a more urgent task is ready.*/
+	if( currentTaskTCB != OS_idleTCB_p ){
+		uint32_t isCurrentTaskDone = currentTaskTCB->state & TASK_STATE_EXIT;
+		uint32_t hasTaskStateChanged = currentTaskTCB->state & (TASK_STATE_YIELD | TASK_STATE_WAIT | TASK_STATE_SLEEP);
+		if(!isCurrentTaskDone && !hasTaskStateChanged && !__shouldPreempt(currentTaskTCB)){
+			//task is allowed to continue running
+			return currentTaskTCB;
+		}
+	}
+
+	/*free resources associated with tasks that have run to completion in earlier runs (the task switched away from now is only queued
+	further down, see OS_reclaimTaskLater). These resources might not have been freed yet because the memcluster was in use.*/
+	OS_reclaimCompletedTasks();
+
+	currentTaskTCB->state &= ~TASK_STATE_YIELD;// reset so task has chance of running after next task switch
+
+	/*the task that just ran goes back into the readyHeap/backgroundQueue if it is still ready
+	(THIS MUST RUN BEFORE SELECTING THE NEXT TASK! DONT MOVE THIS!)*/
+	__putBackRunningTask();
+
+	/*select the job with the earliest deadline, or the next background task if no job is ready*/
+	void * selectedTask;
+	if(OS_heap_removeNode(readyHeap,&selectedTask)){
+		runningTask = (OS_TCB_t *)selectedTask;
+	}else{
+		uint32_t level = OS_readyQueue_highestLevel(backgroundQueue);
+		if(level == READY_QUEUE_NO_LEVEL){
+			return OS_idleTCB_p;// no ready tasks currently (maybe all sleeping).
+		}
+		runningTask = OS_readyQueue_peekLevel(backgroundQueue,level);
+		OS_readyQueue_remove(backgroundQueue,runningTask);
+	}
+	runningTaskStartTick = OS_elapsedTicks();
+	return runningTask;
+}
+
+//=============================================================================
+// Task related function definitions
+//=============================================================================
+
+void OS_edf_initPeriodicTask(OS_TCB_t * TCB, uint32_t period, uint32_t relativeDeadline, uint32_t wcet){
+	if(relativeDeadline == 0){
+		relativeDeadline = period;
+	}
+	if(period == 0 || period > EDF_SCHEDULER_MAX_PERIOD || relativeDeadline > period || wcet == 0 || wcet > relativeDeadline){
+		printf("\r\nEDF SCHEDULER: ERROR, invalid periodic task parameters (period %d, deadline %d, wcet %d) for task %p!\r\n",period,relativeDeadline,wcet,TCB);
+		ASSERT(0);
+		return;
+	}
+	TCB->period = period;
+	TCB->relativeDeadline = relativeDeadline;
+	TCB->wcet = wcet;
+	TCB->deadlineMisses = 0;
+}
+
+/* Adds a task to the scheduler. Periodic tasks release their first job straight away and are only accepted if the total utilization stays
+within EDF_SCHEDULER_MAX_UTILIZATION. The priority of a periodic task is ignored, background tasks are ordered by it.
+*/
+static void edfScheduler_addTask(OS_TCB_t * const tcb,uint32_t task_priority){
+	if(tcb == NULL){
+		printf("\r\nEDF SCHEDULER: ERROR, attempt to add null pointer tcb to scheduler!\r\n");
+		ASSERT(0);
+		return;
+	}else if(tcb->state != 0){
+		printf("\r\nEDF SCHEDULER: ERROR, cannot add tasks that have a state other than 0x00 to scheduler! The task you tried to add has state 0x%08x\r\n",tcb->state);
+		ASSERT(0);
+		return;
+	}else if(task_priority == 0){
+		printf("\r\nEDF SCHEDULER: ERROR, tried to add task with priority 0, lowest allowed priority is 1!\r\n");
+		ASSERT(0);
+		return;
+	}
+	if(!__reserveReadyHeapCapacity(numTasks + 1)){
+		printf("\r\nEDF SCHEDULER: unable to add task %p, the readyHeap could not grow beyond %d tasks!\r\n",tcb,readyHeap->maxNumberOfNodes);
+		return;
+	}
+	tcb->priority = task_priority;
+	if(tcb->period){
+		uint32_t utilization = __utilizationOf(tcb);
+		if(totalUtilization + utilization > EDF_SCHEDULER_MAX_UTILIZATION){
+			printf("\r\nEDF SCHEDULER: unable to add periodic task %p, utilization would rise to %d/%d!\r\n",tcb,totalUtilization + utilization,EDF_SCHEDULER_UTILIZATION_ONE);
+			return;
+		}
+		totalUtilization += utilization;
+		tcb->nextRelease = OS_elapsedTicks();
+		__releaseJob(tcb);
+	}
+	numTasks++;
+	__makeReady(tcb);
+}
+
+/* This function is automatically called when a task exits. The task is running and therefore not in any ready structure, the scheduler
+reclaims it when it switches away from it.
+
+NOTE: this function should NEVER be called manually
+*/
+static void edfScheduler_taskExit(OS_TCB_t * const tcb){
+	tcb->state |= TASK_STATE_EXIT;
+	tcb->data = NULL; // used in completed tasks linked list. Needs to be NULL if not pointing to other completed task
+	if(tcb->period){
+		totalUtilization -= __utilizationOf(tcb);
+	}
+}
+
+/* Called through OS_waitForNextPeriod() when a periodic task is done with its job. Counts a deadline miss if the job finished late and
+puts the task into the sleepWheel until its next job is released. If that release is already due (the job overran into the next period)
+the next job is released straight away.*/
+static void edfScheduler_periodComplete(OS_TCB_t * const tcb){
+	if(tcb->period == 0){
+		tcb->state |= TASK_STATE_YIELD;// not periodic, behave like OS_yield()
+		return;
+	}
+	uint32_t now = OS_elapsedTicks();
+	if(OS_TICK_IS_BEFORE(tcb->absoluteDeadline,now)){
+		tcb->deadlineMisses++;
+		totalDeadlineMisses++;
+	}
+	tcb->nextRelease += tcb->period;
+	if(OS_TICK_IS_BEFORE(now,tcb->nextRelease)){
+		tcb->state |= TASK_STATE_SLEEP | TASK_STATE_PERIOD_WAIT;
+		OS_timingWheel_insert(sleepWheel,&tcb->sleepNode,tcb->nextRelease);
+	}else{
+		__releaseJob(tcb);
+		tcb->state |= TASK_STATE_YIELD;// let the scheduler compare the new deadline with the other jobs
+	}
+}
+
+//=============================================================================
+// wait, notify and sleep
+//=============================================================================
+
+/*Marks the current task as waiting and queues it in the wait list of the object it waits for. The task is running and therefore
+not in any ready structure, the scheduler will not put it back as long as it is waiting.
+
+NOTE: there is no priority/deadline inheritance, a job that waits on a mutex held by a job with a later deadline waits until that job
+releases it. Keep critical sections shared between periodic tasks short.*/
+static void edfScheduler_waitCallback(void * const _reason, uint32_t checkCode,uint32_t _isReasonMutex){
+	if (checkCode != OS_checkCode(_reason)){
+		return;//checkcode mismatch, notify called during function that uses wait
+	}
+	OS_TCB_t * currentTCB = OS_currentTCB();
+	OS_waitList_insert((OS_waitList_t *)_reason,currentTCB,_reason);
+	currentTCB->state |= TASK_STATE_WAIT;
+	if(_isReasonMutex){
+		currentTCB->waitingOnMutex = _reason;
+	}
+}
+
+static void edfScheduler_notifyCallback(void * const reason){
+	/*make all the tasks that are waiting for the given reason ready again*/
+	OS_waitList_t * waiters = (OS_waitList_t *)reason;
+	while(waiters->head){
+		OS_TCB_t * task = waiters->head;
+		OS_waitList_wake(waiters,task);
+		__makeReady(task);
+	}
+	OS_mutex_unregisterAcquired(OS_currentTCB(),reason);
+}
+
+/*wakes only the highest priority waiter and hands a released mutex to it directly (see OS_mutex_handOff)*/
+static void edfScheduler_notifyOneCallback(void * const reason, uint32_t _isReasonMutex){
+	OS_TCB_t * task;
+	if(_isReasonMutex){
+		task = OS_mutex_handOff((OS_mutex_t *)reason);
+	}else{
+		task = OS_waitList_wakeOne((OS_waitList_t *)reason);
+	}
+	if(task){
+		__makeReady(task);
+	}
+	OS_mutex_unregisterAcquired(OS_currentTCB(),reason);
+}
+
+/* puts the task into the sleepWheel. A periodic task keeps the deadline of its current job whilst it sleeps.*/
+static void edfScheduler_sleepCallback(OS_TCB_t * const tcb,uint32_t min_sleep_duration){
+	if(min_sleep_duration == 0){
+		return;
+	}
+	if(min_sleep_duration > TIMING_WHEEL_MAX_DELAY){
+		min_sleep_duration = TIMING_WHEEL_MAX_DELAY;
+	}
+	tcb->state |= TASK_STATE_SLEEP;
+	if(!OS_timingWheel_insert(sleepWheel,&tcb->sleepNode,OS_elapsedTicks() + min_sleep_duration)){
+		__wakeTask(tcb);// wake tick already reached
+	}
+}
+
+static void edfScheduler_resourceAcquired(OS_mutex_t * _acquiredMutex){
+	OS_mutex_registerAcquired(OS_currentTCB(),_acquiredMutex);// no priority inheritance, the list is only kept up to date
+}
+
+/* changes the priority of a task at run time. Periodic jobs are ordered by their deadlines, for them this only affects their place in
+the wait lists they are queued in. A ready background task moves to the level of its new priority in the backgroundQueue (O(1)).
+
+RETURNS: 1 on success, 0 if the task has not been added (or exited) or the priority is 0*/
+static uint32_t edfScheduler_setPriority(OS_TCB_t * const tcb, uint32_t task_priority){
+	if(tcb == NULL || tcb->priority == 0 || (tcb->state & TASK_STATE_EXIT)){
+		printf("\r\nEDF SCHEDULER: ERROR, cannot change the priority of task %p, it is not scheduled!\r\n",tcb);
+		return 0;
+	}else if(task_priority == 0){
+		printf("\r\nEDF SCHEDULER: ERROR, tried to set priority 0, lowest allowed priority is 1!\r\n");
+		return 0;
+	}
+	tcb->priority = task_priority;
+	if(OS_readyQueue_remove(backgroundQueue,tcb)){
+		OS_readyQueue_add(backgroundQueue,tcb,task_priority);
+	}
+	if(tcb->waitReason){
+		OS_waitList_reposition((OS_waitList_t *)tcb->waitReason,tcb);
+	}
+	return 1;
+}
+
+/* Used by the OS for tickless idle, covers both sleeping tasks and job releases.
+
+RETURNS: number of ticks until the next wakeup (never too late, might be early), UINT32_MAX if nothing is due*/
+static uint32_t edfScheduler_ticksUntilNextWakeup(void){
+	return OS_timingWheel_ticksUntilNextEvent(sleepWheel);
+}
+
+//=============================================================================
+// Internal utility functions
+//=============================================================================
+
+/* RETURNS: wcet/period of the task in 1/EDF_SCHEDULER_UTILIZATION_ONE (rounded up, so the admission test errs on the safe side)*/
+static uint32_t __utilizationOf(OS_TCB_t * task){
+	return (uint32_t)((((uint64_t)task->wcet << 16) + task->period - 1) / task->period);
+}
+
+/* RETURNS: the deadline of the current job of the task relative to deadlineBase, the value the readyHeap is ordered by*/
+static uint32_t __deadlineKey(OS_TCB_t * task){
+	if(OS_TICK_IS_BEFORE(task->absoluteDeadline,deadlineBase)){
+		return 0;// long overdue, as urgent as it gets
+	}
+	return task->absoluteDeadline - deadlineBase;
+}
+
+/* RETURNS: 1 if a task that is more urgent than the running task is ready, or if the running background task used up its time slice*/
+static uint32_t __shouldPreempt(OS_TCB_t * task){
+	if(task->period){
+		/*ties go to the running job, switching would not make either deadline easier to meet*/
+		return readyHeap->currentNumNodes && OS_heap_nodeAt(readyHeap,0)->nodeValue < __deadlineKey(task);
+	}
+	if(readyHeap->currentNumNodes){
+		return 1;
+	}
+	if(OS_readyQueue_highestLevel(backgroundQueue) < OS_readyQueue_levelOfPriority(task->priority)){
+		return 1;
+	}
+	return (OS_elapsedTicks() - runningTaskStartTick) >= EDF_SCHEDULER_BACKGROUND_QUANTUM_IN_SYSTICKS;
+}
+
+/* starts the job of a periodic task that is released at task->nextRelease*/
+static void __releaseJob(OS_TCB_t * task){
+	task->absoluteDeadline = task->nextRelease + task->relativeDeadline;
+}
+
+/* adds a task that became ready to the readyHeap (periodic tasks) or the backgroundQueue. The running task is left alone, the scheduler
+puts it back when it switches away from it.*/
+static void __makeReady(OS_TCB_t * task){
+	if(task == runningTask){
+		return;
+	}
+	if(task->period == 0){
+		OS_readyQueue_add(backgroundQueue,task,task->priority);
+	}else if(!OS_heap_addNode(readyHeap,task,__deadlineKey(task))){
+		printf("\u001b[31m\r\nEDF SCHEDULER: ERROR, readyHeap is full, unable to add task %p!\r\n",task);
+		DEBUG_schedulerState();
+		printf("\u001b[0m");
+		ASSERT(0);
+	}
+}
+
+/* puts the task that ran last back into the readyHeap/backgroundQueue if it is still ready, reclaims it if it exited.*/
+static void __putBackRunningTask(void){
+	OS_TCB_t * task = runningTask;
+	if(task == NULL){
+		return;
+	}
+	runningTask = NULL;
+	if(task->state & TASK_STATE_EXIT){
+		__reclaimTask(task);
+	}else if(!(task->state & (TASK_STATE_WAIT | TASK_STATE_SLEEP))){
+		__makeReady(task);
+	}
+}
+
+/* moves deadlineBase forward so that the deadlines in the readyHeap stay far away from overflowing. All keys shift by the same amount so
+the order of the heap does not change (keys of jobs overdue by more than EDF_SCHEDULER_MAX_PERIOD are clamped to 0).*/
+static void __rebaseDeadlines(void){
+	uint32_t newBase = OS_elapsedTicks() - EDF_SCHEDULER_MAX_PERIOD;
+	uint32_t shift = newBase - deadlineBase;
+	for(uint32_t i=0;i<readyHeap->currentNumNodes;i++){
+		OS_minHeapNode_t * node = OS_heap_nodeAt(readyHeap,i);
+		node->nodeValue = (node->nodeValue > shift) ? node->nodeValue - shift : 0;
+	}
+	deadlineBase = newBase;
+}
+
+/* forgets the exited task that ran last, its stack and TCB are handed back to the memcluster on the next run of the scheduler since the
+context switch still writes to them (see OS_reclaimTaskLater())*/
+static void __reclaimTask(OS_TCB_t * task){
+	numTasks--;
+	OS_reclaimTaskLater(task);
+}
+
+/* makes sure the readyHeap can hold _numTasks tasks, adding a segment from the memcluster if it can not (see the stride scheduler). Background tasks never enter the readyHeap but are counted as well, which wastes a few nodes but keeps this simple.
+
+RETURNS: 1 on success, 0 if the memcluster is in use at the moment, out of memory or _numTasks exceeds HEAP_MAX_NODES*/
+static uint32_t __reserveReadyHeapCapacity(uint32_t _numTasks){
+	if(_numTasks <= readyHeap->maxNumberOfNodes){
+		return 1;
+	}
+	uint32_t success = 0;
+	__disable_irq();
+	if(!OS_isMemclusterInUse()){
+		/* CRITICAL SECTION START (see OS_reclaimTask())*/
+		memory_cluster_setInternalLockState(0);
+		success = OS_heap_grow(readyHeap,_numTasks);
+		memory_cluster_setInternalLockState(1);
+		/* CRITICAL SECTION END*/
+	}
+	__enable_irq();
+	return success;
+}
+
+/* called when the sleepWheel expires a task: either a sleep is over or the next job of a periodic task is released*/
+static void __wakeTask(OS_TCB_t * task){
+	if(task->state & TASK_STATE_PERIOD_WAIT){
+		__releaseJob(task);
+	}
+	task->state &= ~(TASK_STATE_SLEEP | TASK_STATE_PERIOD_WAIT);
+	__makeReady(task);
+}
+
+
+//=============================================================================
+// Externally accessible utility functions
+//=============================================================================
+
+uint32_t OS_edf_getDeadlineMisses(OS_TCB_t * _task){
+	return _task->deadlineMisses;
+}
+
+uint32_t OS_edf_getTotalDeadlineMisses(void){
+	return totalDeadlineMisses;
+}
+
+//=============================================================================
+// DEBUG functions
+//=============================================================================
+
+static void DEBUG_schedulerState(){
+	printf("\r\n\r\n######################################################################\r\n");
+	printf("DEBUG: DUMPING EDF SCHEDULER STATE!\r\n");
+	printf("deadline base: %u, running task: %p, utilization: %u/%u, deadline misses: %u\r\n",deadlineBase,runningTask,totalUtilization,EDF_SCHEDULER_UTILIZATION_ONE,totalDeadlineMisses);
+	printf("\r\nREADY HEAP:\r\n");
+	printHeap(readyHeap);
+	printf("\r\nBACKGROUND QUEUE:\r\n");
+	DEBUG_printReadyQueue(backgroundQueue);
+	printf("\r\nSLEEP WHEEL:\r\n");
+	DEBUG_printTimingWheel(sleepWheel);
+}
@@ -0,0 +1,47 @@
+#ifndef DOCETOS_edfScheduler_H
+#define DOCETOS_edfScheduler_H
+
+#include "os.h"
+#include "stm32f4xx.h"
+#include "structs.h"
+#include "../DataStructures/heap.h"
+#include "../DataStructures/readyQueue.h"
+#include "../DataStructures/timingWheel.h"
+#include "../DataStructures/mutex.h"
+#include "../DataStructures/waitList.h"
+#include "memcluster.h"
+
+/*measured in SysTicks. Time slice of the background (non periodic) tasks, periodic tasks run until their job is done or a job
+with an earlier deadline is released*/
+#define EDF_SCHEDULER_BACKGROUND_QUANTUM_IN_SYSTICKS 10
+
+/* utilization (sum of wcet/period over all periodic tasks) in 1/65536. Periodic tasks that would push the utilization above this
+ * are rejected by OS_addTask, with deadlines equal to periods EDF meets every deadline up to a utilization of 100%.*/
+#define EDF_SCHEDULER_UTILIZATION_ONE (1UL << 16)
+#define EDF_SCHEDULER_MAX_UTILIZATION EDF_SCHEDULER_UTILIZATION_ONE
+
+/* longest period/deadline a periodic task can have, keeps every deadline in the heap less than 2^31 ticks away from the heap base*/
+#define EDF_SCHEDULER_MAX_PERIOD (1UL << 29)
+/* the heap stores deadlines relative to a base tick, once the base is this far behind the current tick it is moved forward*/
+#define EDF_SCHEDULER_REBASE_THRESHOLD (1UL << 30)
+
+/* 1: jobs with equal deadlines run in the order they were released. 0: ties are broken by the shape of the readyHeap.*/
+#define EDF_SCHEDULER_FIFO_TIES 1
+
+/* The readyHeap grows by a segment of HEAP_SEGMENT_NODES tasks whenever a task is added that would not fit, so the number of tasks is
+ * only limited by the memory of the memcluster (and HEAP_MAX_NODES).*/
+void initialize_edfScheduler(uint32_t _initialTaskCapacity);
+extern OS_Scheduler_t const edfScheduler;
+
+/* Turns a task into a periodic task: a job is released every period ticks (starting when the task is added) and has to be done
+ * relativeDeadline ticks after its release (0 = at the end of the period). wcet is the worst case execution time of a job and is used
+ * by OS_addTask to reject task sets the scheduler cannot meet the deadlines of. The task signals that its job is done with
+ * OS_waitForNextPeriod(). Call after OS_initialiseTCB() and before OS_addTask(), tasks that are added without calling this are
+ * background tasks that only run when no job is ready.*/
+void OS_edf_initPeriodicTask(OS_TCB_t * TCB, uint32_t period, uint32_t relativeDeadline, uint32_t wcet);
+
+/*deadline miss counters, a job that completes after its deadline counts as one miss*/
+uint32_t OS_edf_getDeadlineMisses(OS_TCB_t * _task);
+uint32_t OS_edf_getTotalDeadlineMisses(void);
+
+#endif //DOCETOS_edfScheduler_H
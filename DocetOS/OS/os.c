@@ -17,19 +17,45 @@ OS_TCB_t const * const OS_idleTCB_p = &OS_idleTCB;
 /* Total elapsed ticks */
 static volatile uint32_t _ticks = 0;
 
+/* Number of core clock cycles per tick, set once SysTick has been configured */
+static uint32_t _sysTickCyclesPerTick = 0;
+
+/* Number of ticks SysTick has been programmed to span while idling (0 = SysTick fires every tick) */
+static volatile uint32_t _ticklessIdleTicks = 0;
+
+/* GLOBAL: read by the idle task (see os_asm.s), WFI is only executed if this is set */
+uint32_t const _OS_idleSleepEnabled = OS_TICKLESS_IDLE;
+
 /* Pointer to the 'scheduler' struct containing callback pointers */
 static OS_Scheduler_t const * _scheduler = 0;
 
 /* Pointer to the memcluster. used for allocating memory */
 static OS_memcluster_t _memcluster;
 
+/* Exited tasks whose memory could not be handed back to the memcluster yet, linked through their data field (see OS_reclaimTask()) */
+static OS_TCB_t * _completedTasks = NULL;
+
 /* pointer to channel manager struct. Manages channels used for inter task communication*/
 static OS_channelManager_t const *_channelManager = 0;
 
-/* GLOBAL: check code used by wait() function to determine if wait is still needed or if notify has been called in the interim*/
-static volatile uint32_t  _checkCode = 0;
-uint32_t OS_checkCode(void){
-	return _checkCode;
+/* check code used by wait() function to determine if wait is still needed or if notify has been called in the interim.
+The code is the sequence counter of the object being waited on, so a notify on one object does not force the waiters of every
+other object to retry. _reason must point to an object that starts with an OS_waitList_t (see waitList.c)*/
+uint32_t OS_checkCode(void * _reason){
+	return ((OS_waitList_t *)_reason)->sequence;
+}
+
+/* advances the sequence counter of the notified object*/
+static void __bumpCheckCode(void * _reason){
+	uint32_t * sequence = (uint32_t *)&((OS_waitList_t *)_reason)->sequence;
+	uint32_t notStored = 1;
+	/* following do-while makes sure that every notify results in a change to the check code.
+	(even though this is not a problem at the moment since no higher priority interrupt does anything with notify() )*/
+	do{
+		uint32_t temp_checkCode = (uint32_t)__LDREXW(sequence);
+		temp_checkCode++; // change check code to inform any wait() calls that notify has been called in interim
+		notStored = __STREXW(temp_checkCode,sequence);//returns 0 when success
+	}while(notStored);
 }
 
 /* GLOBAL: Holds pointer to current TCB.  DO NOT MODIFY, EVER. */
@@ -47,10 +73,84 @@ uint32_t OS_elapsedTicks() {
 
 /* IRQ handler for the system tick.  Schedules PendSV */
 void SysTick_Handler(void) {
-	_ticks = _ticks + 1;
+	if(_ticklessIdleTicks){
+		/*the whole tickless idle period has elapsed, account for all of it and go back to one interrupt per tick*/
+		_ticks = _ticks + _ticklessIdleTicks;
+		_ticklessIdleTicks = 0;
+		SysTick->LOAD = _sysTickCyclesPerTick - 1;
+		SysTick->VAL = 0;
+	}else{
+		_ticks = _ticks + 1;
+	}
 	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
 }
 
+#if OS_TICKLESS_IDLE
+/* Called when the scheduler has nothing to run. Reprograms SysTick so that its next interrupt occurs when the earliest sleeping
+task is due to wake, instead of on the next tick. Nothing is done if that is less than two ticks away or if the scheduler cannot
+report its next wakeup.*/
+static void __enterTicklessIdle(void){
+	if(!_scheduler->preemptive || !_scheduler->ticksUntilNextWakeup_callback || !_sysTickCyclesPerTick){
+		return;
+	}
+	uint32_t ticks = _scheduler->ticksUntilNextWakeup_callback();
+	uint32_t maxTicks = SysTick_LOAD_RELOAD_Msk / _sysTickCyclesPerTick;// the reload register is only 24 bits wide
+	if(ticks > maxTicks){
+		ticks = maxTicks;
+	}
+	if(ticks < 2){
+		return;
+	}
+	__disable_irq();
+	if(!(SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)){// a pending tick has to be handled the normal way first
+		/*the part of the current tick that has already elapsed is kept, so the tick phase does not drift*/
+		SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+		SysTick->LOAD = (ticks - 1) * _sysTickCyclesPerTick + SysTick->VAL;
+		SysTick->VAL = 0;
+		SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+		_ticklessIdleTicks = ticks;
+	}
+	__enable_irq();
+}
+
+/* Called when the scheduler runs while SysTick is still programmed for a tickless idle period, which means some other interrupt
+woke the core early. Adds the tick boundaries that have actually been crossed since the period started to _ticks and lets SysTick
+fire at the next boundary, where SysTick_Handler returns it to one interrupt per tick. The partial tick is kept, so an early wake
+neither loses a tick nor shifts the tick phase.*/
+static void __leaveTicklessIdle(void){
+	__disable_irq();
+	if(_ticklessIdleTicks){
+		if(SCB->ICSR & SCB_ICSR_PENDSTSET_Msk){
+			/*the period ran out while interrupts were masked*/
+			SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+			_ticks = _ticks + _ticklessIdleTicks;
+			_ticklessIdleTicks = 0;
+			SysTick->LOAD = _sysTickCyclesPerTick - 1;
+			SysTick->VAL = 0;
+		}else{
+			/*the period ends on a tick boundary (see __enterTicklessIdle), so its boundaries lie at multiples of a tick before its end and
+			VAL counts the cycles until that end*/
+			uint32_t cyclesToEnd = SysTick->VAL;
+			uint32_t boundariesAhead = cyclesToEnd ? (cyclesToEnd - 1) / _sysTickCyclesPerTick + 1 : 0;
+			uint32_t cyclesToNextTick = cyclesToEnd ? (cyclesToEnd - 1) % _sysTickCyclesPerTick + 1 : _sysTickCyclesPerTick;
+			uint32_t ticksUntilInterrupt = 1;
+			_ticks = _ticks + _ticklessIdleTicks - boundariesAhead;
+			if(cyclesToNextTick < 2){
+				/*too short to program, the interrupt is moved to the boundary after it and accounts for both ticks*/
+				cyclesToNextTick += _sysTickCyclesPerTick;
+				ticksUntilInterrupt = 2;
+			}
+			SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+			SysTick->LOAD = cyclesToNextTick - 1;
+			SysTick->VAL = 0;
+			SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+			_ticklessIdleTicks = ticksUntilInterrupt;
+		}
+	}
+	__enable_irq();
+}
+#endif
+
 /* SVC handler for OS_schedule().  Simply schedules PendSV */
 void _svc_OS_schedule(void) {
 	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
@@ -58,17 +158,21 @@ void _svc_OS_schedule(void) {
 
 /* Sets up the OS by storing a pointer to the structure containing all the callbacks.
    Also establishes the system tick timer and interrupt if preemption is enabled. */
-void OS_init(OS_Scheduler_t const * scheduler,uint32_t * memory,uint32_t memory_size) {
+void OS_init(OS_Scheduler_t const * scheduler,uint32_t * memory,uint32_t memory_size,uint32_t taskCapacity) {
 	_scheduler = scheduler;
 	_channelManager = &channelManager;
   *((uint32_t volatile *)0xE000ED14) |= (1 << 9); // Set STKALIGN
+	ASSERT(_scheduler->init_callback);
 	ASSERT(_scheduler->scheduler_callback);
 	ASSERT(_scheduler->addtask_callback);
 	ASSERT(_scheduler->taskexit_callback);
 	ASSERT(_scheduler->wait_callback);
 	ASSERT(_scheduler->notify_callback);
+	/*the idle task is never linked into a ready queue or the sleep wheel, zero is a valid level and slot so mark it as unlinked*/
+	OS_idleTCB.readyLevel = READY_QUEUE_LEVEL_NONE;
+	OS_timingWheel_initNode(&OS_idleTCB.sleepNode,&OS_idleTCB);
 	memory_cluster_init(&_memcluster,memory,memory_size); //TODO why &_memcluster ?
-	initialize_scheduler(16);
+	_scheduler->init_callback(taskCapacity ? taskCapacity : OS_DEFAULT_TASK_CAPACITY);
 	initialize_channelManager(16);
 }
 
@@ -87,6 +191,60 @@ uint32_t OS_isMemclusterInUse(){
 	return _memcluster.clusterInUseFLAG;
 }
 
+/* Frees the stack and TCB of a task. Interrupts have to be disabled and the memcluster must not be in use, the internal mutexes of the
+   memcluster cannot use svc callbacks from handler mode, so they are switched off for the duration. */
+static void __freeTask(OS_TCB_t * task){
+	memory_cluster_setInternalLockState(0);
+	OS_free((uint32_t*)task->originalSpMemoryPointer);
+	OS_free((uint32_t*)task);
+	memory_cluster_setInternalLockState(1);
+}
+
+/* Called by the schedulers for an exited task that is no longer linked into any of their structures. The stack and
+   TCB of the task are handed back to the memcluster straight away, unless the interrupted task is using the memcluster, in which case
+   they are freed by the next OS_reclaimCompletedTasks(). A joinable task is left alone, OS_join() frees it. */
+void OS_reclaimTask(OS_TCB_t * task){
+	if(task->joinable){
+		return;
+	}
+	__disable_irq();
+	if(!OS_isMemclusterInUse()){
+		__freeTask(task);
+	}else{
+		task->data = (uint32_t)_completedTasks;
+		_completedTasks = task;
+	}
+	__enable_irq();
+}
+
+/* Same as OS_reclaimTask(), but the memory is always freed by the next OS_reclaimCompletedTasks(). Used for the task the scheduler
+   is switching away from: the context switch still saves its registers to its stack and its stack pointer to its TCB once the scheduler
+   returns, so a scheduler has to call OS_reclaimCompletedTasks() before it queues the outgoing task, never after. */
+void OS_reclaimTaskLater(OS_TCB_t * task){
+	if(task->joinable){
+		return;
+	}
+	task->data = (uint32_t)_completedTasks;
+	_completedTasks = task;
+}
+
+/* Frees every task queued by OS_reclaimTask()/OS_reclaimTaskLater(), provided the memcluster is not in use at the moment. Called by
+   the schedulers every time they run. */
+void OS_reclaimCompletedTasks(void){
+	if(_completedTasks == NULL){
+		return;
+	}
+	__disable_irq();
+	if(!OS_isMemclusterInUse()){
+		while(_completedTasks){
+			OS_TCB_t * task = _completedTasks;
+			_completedTasks = (OS_TCB_t *)task->data;
+			__freeTask(task);
+		}
+	}
+	__enable_irq();
+}
+
 /* Starts the OS and never returns. */
 void OS_start() {
 	ASSERT(_scheduler);
@@ -99,6 +257,18 @@ void OS_initialiseTCB(OS_TCB_t * TCB, uint32_t * const stack, void (* const func
 	TCB->originalSpMemoryPointer = stack - 64; //needed for dealloc of stack later on
 	TCB->sp = stack - (sizeof(OS_StackFrame_t) / sizeof(uint32_t));
 	TCB->priority = TCB->inheritedPriority = TCB->prevInheritedPriority = TCB->state = TCB->data = 0;
+	TCB->readyNext = TCB->readyPrev = NULL;
+	TCB->acquiredResourcesLinkedList = TCB->waitingOnMutex = NULL;
+	TCB->waitReason = TCB->waitNext = TCB->waitPrev = NULL;
+	TCB->readyLevel = READY_QUEUE_LEVEL_NONE; // not linked into any ready queue until added to the scheduler
+	OS_timingWheel_initNode(&TCB->sleepNode,TCB);
+	TCB->pass = TCB->stride = 0;
+	TCB->quantum = TCB->budget = TCB->budgetPeriod = TCB->budgetUsed = TCB->budgetPeriodStart = 0;
+	TCB->period = TCB->relativeDeadline = TCB->wcet = TCB->absoluteDeadline = TCB->nextRelease = TCB->deadlineMisses = 0;
+	TCB->taskGroup = NULL;
+	TCB->priorityBias = 0;
+	TCB->joinable = TCB->exitValue = 0;
+	OS_waitList_init(&TCB->joinWaiters);
 	OS_StackFrame_t *sf = (OS_StackFrame_t *)(TCB->sp);
 	memset(sf, 0, sizeof(OS_StackFrame_t));
 	/* By placing the address of the task function in pc, and the address of _OS_task_end() in lr, the task
@@ -110,11 +280,69 @@ void OS_initialiseTCB(OS_TCB_t * TCB, uint32_t * const stack, void (* const func
 	sf->psr = 0x01000000;  /* Sets the thumb bit to avoid a big steaming fault */
 }
 
+/* Sets the number of ticks the task may run for before the scheduler picks again, 0 selects the default of the scheduler.
+   Must be called before the task is added to the scheduler. */
+void OS_setTaskQuantum(OS_TCB_t * TCB, uint32_t quantum_ticks) {
+	TCB->quantum = quantum_ticks;
+}
+
+/* Limits the task to budget_ticks of cpu time in every period of period_ticks. Once the budget is used up the task is throttled
+   (not run) until the next period starts. A budget of 0 removes the limit. Must be called before the task is added to the scheduler. */
+void OS_setTaskBudget(OS_TCB_t * TCB, uint32_t budget_ticks, uint32_t period_ticks) {
+	if(budget_ticks && period_ticks < budget_ticks){
+		period_ticks = budget_ticks;// a budget larger than its period would never be exhausted
+	}
+	TCB->budget = budget_ticks;
+	TCB->budgetPeriod = period_ticks;
+	TCB->budgetUsed = 0;
+	TCB->budgetPeriodStart = OS_elapsedTicks();
+}
+
+/* Makes the task a member of group. Membership takes effect when the task is added to the scheduler and lasts for the lifetime of the task.
+   A group of NULL selects the default group. */
+void OS_setTaskGroup(OS_TCB_t * TCB, OS_taskGroup_t * group) {
+	TCB->taskGroup = group;
+}
+
+/* Makes the task joinable: once it exits its memory is not reclaimed by the scheduler but by the task that calls OS_join() for it. */
+void OS_setTaskJoinable(OS_TCB_t * TCB) {
+	TCB->joinable = 1;
+}
+
+/* Ends the calling task with the given exit value (see OS_join()). Never returns. */
+void OS_exit(uint32_t exitValue) {
+	_OS_task_end(exitValue);
+}
+
+/* Blocks until task has exited, stores its exit value in *result (if result is not NULL) and hands the TCB and stack of the task
+   back to the memcluster. The task is guaranteed to have been switched out for good by the time this task runs again, so its memory
+   can be freed straight away. See os.h for details. */
+uint32_t OS_join(OS_TCB_t * task, uint32_t * result) {
+	if(task == NULL || task == _currentTCB || !task->joinable){
+		return 0;
+	}
+	while(1){
+		/*read the check code first, an exit between reading the state and waiting changes it and OS_wait() returns straight away*/
+		uint32_t checkCode = OS_checkCode(&task->joinWaiters);
+		if(task->state & TASK_STATE_EXIT){
+			break;
+		}
+		OS_wait(&task->joinWaiters,checkCode,0);
+	}
+	if(result){
+		*result = task->exitValue;
+	}
+	OS_free((uint32_t*)task->originalSpMemoryPointer);
+	OS_free((uint32_t*)task);
+	return 1;
+}
+
 /* Function that's called by a task when it ends (the address of this function is
    inserted into the link register of the initial stack frame for a task).  Invokes a SVC
-   call (see os_internal.h); the handler is _svc_OS_task_exit() (see below). */
-void _OS_task_end(void) {
-	_OS_task_exit();
+   call (see os_internal.h); the handler is _svc_OS_task_exit() (see below). Whatever the task function left in r0 (its return
+   value, should it be declared to return one) is passed on as the exit value. */
+void _OS_task_end(uint32_t exitValue) {
+	_OS_task_exit(exitValue);
 	/* DO NOT STEP OUT OF THIS FUNCTION when debugging!  PendSV must be allowed to run
 	   and switch tasks.  A hard fault awaits if you ignore this.
 		 If you want to see what happens next, or debug something, set a breakpoint at the
@@ -125,7 +353,8 @@ void _OS_task_end(void) {
 void _svc_OS_enable_systick(void) {
 	if (_scheduler->preemptive) {
 		SystemCoreClockUpdate();
-		SysTick_Config(SystemCoreClock / 1000);
+		_sysTickCyclesPerTick = SystemCoreClock / 1000;
+		SysTick_Config(_sysTickCyclesPerTick);
 		NVIC_SetPriority(SysTick_IRQn, 0x10);
 	}
 }
@@ -177,17 +406,22 @@ void _svc_OS_wait(_OS_SVC_StackFrame_t const * const stack){
 /* SVC handler for OS_notify()*/
 void _svc_OS_notify(_OS_SVC_StackFrame_t const * const stack){
 	void * reason = (void *)stack->r0;
-	uint32_t notStored = 1;
-	/* following do-while makes sure that every notify results in a change to _checkCode.
-	(even though this is not a problem at the moment since no higher priority interrupt does anything with notify() )*/
-	do{
-		uint32_t temp_checkCode = (uint32_t)__LDREXW((uint32_t *)&_checkCode);
-		temp_checkCode++; // change check code to inform any wait() calls that notify has been called in interim
-		notStored = __STREXW(temp_checkCode,(uint32_t *)&_checkCode);//returns 0 when success
-	}while(notStored);
+	__bumpCheckCode(reason);
 	_scheduler->notify_callback(reason);
 }
 
+/* SVC handler for OS_notifyOne()*/
+void _svc_OS_notifyOne(_OS_SVC_StackFrame_t const * const stack){
+	void * reason = (void *)stack->r0;
+	uint32_t isReasonMutex = (uint32_t)stack->r1;
+	__bumpCheckCode(reason);
+	if(_scheduler->notifyOne_callback){
+		_scheduler->notifyOne_callback(reason,isReasonMutex);
+	}else{
+		_scheduler->notify_callback(reason);
+	}
+}
+
 /* SVC handler to add a task.  Invokes a callback to do the work. */
 void _svc_OS_addTask(_OS_SVC_StackFrame_t const * const stack) {
 	/* The TCB pointer is on the stack in the r0 position, having been passed as an
@@ -208,15 +442,50 @@ void _svc_OS_sleep(_OS_SVC_StackFrame_t const * const stack){
 	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk; // dont want to continue execution of task after sleep call
 }
 
+/* SVC handler for OS_sleepUntil(). The wake tick is absolute, so the time the task spent running since its last wakeup does not
+add to its period. Tick values are compared wrap-safe.*/
+void _svc_OS_sleepUntil(_OS_SVC_StackFrame_t const * const stack){
+	OS_TCB_t * task = _currentTCB;
+	uint32_t * lastWakeTick = (uint32_t *)stack->r0;
+	uint32_t period = stack->r1;
+	uint32_t wakeTick = *lastWakeTick + period;
+	*lastWakeTick = wakeTick;
+	if(!OS_TICK_IS_BEFORE(_ticks,wakeTick)){
+		return;// wake tick already passed, the task is late and continues straight away
+	}
+	if(_scheduler->sleepUntil_callback){
+		_scheduler->sleepUntil_callback(task,wakeTick);
+	}else{
+		_scheduler->sleep_callback(task,wakeTick - _ticks);
+	}
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk; // dont want to continue execution of task after sleep call
+}
+
 /* SVC handler to invoke the scheduler (via a callback) from PendSV */
 OS_TCB_t const * _OS_scheduler() {
+#if OS_TICKLESS_IDLE
+	__leaveTicklessIdle();
+	OS_TCB_t const * nextTCB = _scheduler->scheduler_callback();
+	if(nextTCB == OS_idleTCB_p){
+		__enterTicklessIdle();
+	}
+	return nextTCB;
+#else
 	return _scheduler->scheduler_callback();
+#endif
 }
 
 /* SVC handler that's called by _OS_task_end when a task finishes.  Invokes the
-   task end callback and then queues PendSV to call the scheduler. */
-void _svc_OS_task_exit(void) {
-	_scheduler->taskexit_callback(_currentTCB);
+   task end callback and then queues PendSV to call the scheduler. A joinable task wakes the task waiting for it in OS_join(), which
+   only runs once PendSV has switched away from the exiting task. */
+void _svc_OS_task_exit(_OS_SVC_StackFrame_t const * const stack) {
+	OS_TCB_t * task = _currentTCB;
+	task->exitValue = stack->r0;
+	_scheduler->taskexit_callback(task);
+	if(task->joinable){
+		__bumpCheckCode(&task->joinWaiters);
+		_scheduler->notify_callback(&task->joinWaiters);
+	}
 	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
 }
 
@@ -231,6 +500,68 @@ void _svc_OS_resource_acquired(_OS_SVC_StackFrame_t const * const stack) {
 	_scheduler->resourceAcquired_callback(resource);
 }
 
+/* wrapper around the svc delegate. RETURNS: 1 if the priority was changed, 0 if the scheduler does not support it or the arguments are invalid*/
+uint32_t OS_setPriority(OS_TCB_t * task, uint32_t priority){
+	__OS_setPriority(task,priority);
+	return OS_currentTCB()->svc_return;
+}
+
+/* SVC handler for OS_setPriority(). The scheduler moves the task to wherever its new priority puts it (ready queue and wait list).
+PendSV is pended so that a task which now outranks the running task (or a running task that dropped below another one) is switched
+without waiting for the next tick.*/
+void _svc_OS_setPriority(_OS_SVC_StackFrame_t const * const stack) {
+	OS_TCB_t * task = (OS_TCB_t *)stack->r0;
+	uint32_t priority = stack->r1;
+	uint32_t success = 0;
+	if(_scheduler->setPriority_callback){
+		success = _scheduler->setPriority_callback(task,priority);
+	}
+	_currentTCB->svc_return = success;
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+/* wrappers around the svc delegates. RETURNS: 1 on success, 0 if the scheduler does not support it or the task is not scheduled*/
+uint32_t OS_suspend(OS_TCB_t * task){
+	__OS_suspend(task);
+	return OS_currentTCB()->svc_return;
+}
+
+uint32_t OS_resume(OS_TCB_t * task){
+	__OS_resume(task);
+	return OS_currentTCB()->svc_return;
+}
+
+/* SVC handler for OS_suspend(). PendSV is pended so that a task that suspended itself stops running straight away.*/
+void _svc_OS_suspend(_OS_SVC_StackFrame_t const * const stack) {
+	OS_TCB_t * task = (OS_TCB_t *)stack->r0;
+	uint32_t success = 0;
+	if(_scheduler->suspend_callback){
+		success = _scheduler->suspend_callback(task);
+	}
+	_currentTCB->svc_return = success;
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+/* SVC handler for OS_resume(). Whether the resumed task should run straight away is left to the scheduler.*/
+void _svc_OS_resume(_OS_SVC_StackFrame_t const * const stack) {
+	OS_TCB_t * task = (OS_TCB_t *)stack->r0;
+	uint32_t success = 0;
+	if(_scheduler->resume_callback){
+		success = _scheduler->resume_callback(task);
+	}
+	_currentTCB->svc_return = success;
+}
+
+/* SVC handler for OS_waitForNextPeriod(). Schedulers without periodic tasks treat it like OS_yield() */
+void _svc_OS_wait_next_period(void) {
+	if(_scheduler->periodComplete_callback){
+		_scheduler->periodComplete_callback(_currentTCB);
+	}else{
+		_currentTCB->state |= TASK_STATE_YIELD;
+	}
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
 //=============================================================================
 // channel manager svc
 //=============================================================================
@@ -4,6 +4,14 @@
 #include "task.h"
 #include "structs.h"
 
+/* 1: when the scheduler has nothing to run, SysTick is reprogrammed to fire at the next wakeup the scheduler reports and the idle
+ *    task sleeps (WFI) until then. The elapsed ticks are corrected when the core wakes up.
+ * 0: SysTick fires every tick and the idle task busy waits. Use this when debugging, WFI does not play nicely with the debugger.*/
+#define OS_TICKLESS_IDLE 0
+
+/* number of tasks the scheduler sizes its internal data structures for if OS_init() is not given a capacity*/
+#define OS_DEFAULT_TASK_CAPACITY 16
+
 /********************/
 /* Type definitions */
 /********************/
@@ -22,12 +30,19 @@ enum OS_SVC_e {
 	OS_CHANNEL_CONNECT,
 	OS_CHANNEL_DISCONNECT,
 	OS_CHANNEL_CHECK,
-	OS_RESOURCE_ACQUIRED
+	OS_RESOURCE_ACQUIRED,
+	OS_SVC_WAIT_NEXT_PERIOD,
+	OS_SVC_SLEEP_UNTIL,
+	OS_SVC_NOTIFY_ONE,
+	OS_SVC_SET_PRIORITY,
+	OS_SVC_SUSPEND,
+	OS_SVC_RESUME
 };
 
 /* A structure to hold callbacks for a scheduler, plus a 'preemptive' flag */
 typedef struct {
 	uint_fast8_t preemptive;
+	void (* init_callback)(uint32_t initialTaskCapacity);//ME:called once by OS_init to set up the internal data structures of the scheduler
 	OS_TCB_t const * (* scheduler_callback)(void);//ME:called by SysTick or when task yields
 	void (* addtask_callback)(OS_TCB_t * const newTask, uint32_t taskPriority);//ME:called by user...to add task to scheduler
 	void (* taskexit_callback)(OS_TCB_t * const task);//ME:called automatically on task func return. DO NOT CALL MANUALLY
@@ -35,6 +50,13 @@ typedef struct {
 	void (* notify_callback)(void * const reason);
 	void (* sleep_callback)(OS_TCB_t * const task,uint32_t min_duration);
 	void (* resourceAcquired_callback)(OS_mutex_t * _resource);
+	uint32_t (* ticksUntilNextWakeup_callback)(void);//ME:optional, used for tickless idle. UINT32_MAX if no task is due to wake
+	void (* periodComplete_callback)(OS_TCB_t * const task);//ME:optional, called when a periodic task is done with its current job
+	void (* sleepUntil_callback)(OS_TCB_t * const task,uint32_t wake_tick);//ME:optional, sleep_callback is used with the remaining ticks if NULL
+	void (* notifyOne_callback)(void * const reason, uint32_t _isReasonMutex);//ME:optional, notify_callback (wakes every waiter) is used if NULL
+	uint32_t (* setPriority_callback)(OS_TCB_t * const task, uint32_t priority);//ME:optional, OS_setPriority() fails if NULL. 1 on success
+	uint32_t (* suspend_callback)(OS_TCB_t * const task);//ME:optional, OS_suspend() fails if NULL. 1 on success
+	uint32_t (* resume_callback)(OS_TCB_t * const task);//ME:optional, OS_resume() fails if NULL. 1 on success
 } OS_Scheduler_t;
 
 /***************************/
@@ -42,8 +64,11 @@ typedef struct {
 /***************************/
 
 /* Initialises the OS.  Must be called before OS_start().  The argument is a pointer to an
-   OS_Scheduler_t structure (see above). */
-void OS_init(OS_Scheduler_t const * scheduler,uint32_t * memory,uint32_t memory_size);
+   OS_Scheduler_t structure (see above). taskCapacity is the number of tasks the scheduler sizes its
+   internal data structures for (0 = OS_DEFAULT_TASK_CAPACITY), they grow from the memcluster should
+   more tasks be added. Only the stride and EDF schedulers preallocate (their readyHeap), the stochastic
+   and cyclic schedulers keep their tasks in lists linked through the TCBs and ignore taskCapacity. */
+void OS_init(OS_Scheduler_t const * scheduler,uint32_t * memory,uint32_t memory_size,uint32_t taskCapacity);
 
 /* Starts the OS kernel.  Never returns. */
 void OS_start(void);
@@ -54,13 +79,18 @@ OS_TCB_t * OS_currentTCB(void);
 /* Returns the number of elapsed systicks since the last reboot (modulo 2^32). */
 uint32_t OS_elapsedTicks(void);
 
-/* Returns check code used in OS_wait() to determine if wait is still needed*/
-uint32_t OS_checkCode(void);
+/* Wrap-safe comparison of two tick values, valid as long as the two ticks are less than 2^31 ticks apart. */
+#define OS_TICK_IS_BEFORE(a,b) ((int32_t)((uint32_t)(a) - (uint32_t)(b)) < 0)
+
+/* Returns check code of the object _reason used in OS_wait() to determine if wait is still needed.
+Only a notify on that same object changes it.*/
+uint32_t OS_checkCode(void * _reason);
 
 /*functions to allow the user to allocate and deallocate memory through
 the memory cluster of the OS*/
 void * OS_alloc(uint32_t num_32bit_words);
 void OS_free(uint32_t * head_ptr);
+uint32_t OS_isMemclusterInUse(void);
 
 /*wrappers around channel functions to hide the use of tcb to retreive return data
 from scv delegate functions from the user. User should not need to call connect and then
@@ -85,6 +115,20 @@ uint32_t OS_channel_check(uint32_t channelID);
    The fourth argument is a void pointer to data that the task should receive. */
 void OS_initialiseTCB(OS_TCB_t * TCB, uint32_t * const stack, void (* const func)(void const * const), void const * const data);
 
+/* Sets the number of ticks a task may run for before the scheduler picks again (0 = scheduler default). Call after
+   OS_initialiseTCB() and before OS_addTask(). */
+void OS_setTaskQuantum(OS_TCB_t * TCB, uint32_t quantum_ticks);
+
+/* Limits a task to budget_ticks of cpu time in every period_ticks (budget_ticks = 0 means unlimited). Once the budget is
+   used up the task is throttled until the next period. Enforced by the stochastic scheduler. Call after OS_initialiseTCB()
+   and before OS_addTask(). */
+void OS_setTaskBudget(OS_TCB_t * TCB, uint32_t budget_ticks, uint32_t period_ticks);
+
+/* Puts a task into a task group (NULL = default group). The scheduler first picks a group according to the groups shares and caps,
+   then a task within the group, so the cpu time of a group does not grow with the number of tasks it spawns. Groups are created
+   with OS_stochastic_newTaskGroup() and enforced by the stochastic scheduler. Call after OS_initialiseTCB() and before OS_addTask(). */
+void OS_setTaskGroup(OS_TCB_t * TCB, OS_taskGroup_t * group);
+
 //=============================================================================
 // scheduler svc
 //=============================================================================
@@ -92,16 +136,51 @@ void OS_initialiseTCB(OS_TCB_t * TCB, uint32_t * const stack, void (* const func
 /* SVC delegate to add a task */
 void __svc(OS_SVC_ADD_TASK) OS_addTask(OS_TCB_t const * const,uint32_t task_priority);
 
-/* SVC delegate to allow task to wait for resource*/
+/* SVC delegate to allow task to wait for resource. reason MUST point to an object that starts with an OS_waitList_t (OS_mutex_t,
+   OS_semaphore_t), the task is queued there until OS_notify() is called with the same reason*/
 void __svc(OS_SVC_WAIT) OS_wait(void * reason, uint32_t check_Code, uint32_t _isReasonMutex);
 
 /* SVC delegate to allow task to notify that a resource has been released*/
 void __svc(OS_SVC_NOTIFY) OS_notify(void * reason);
 
+/* SVC delegate like OS_notify(), but only the highest priority task waiting for reason is woken. If reason is a mutex
+   (_isReasonMutex = 1) that has been released, ownership is handed to the woken task straight away.*/
+void __svc(OS_SVC_NOTIFY_ONE) OS_notifyOne(void * reason, uint32_t _isReasonMutex);
+
 void __svc(OS_SVC_SLEEP) OS_sleep(uint32_t min_sleep_duration);
 
+/* SVC delegate for drift free periodic sleeping. Advances *last_wake_tick by period and sleeps until that absolute tick (returns
+   straight away if it has already passed). Initialise *last_wake_tick with OS_elapsedTicks() once, then call this at the end of
+   every iteration of the loop: the task wakes every period ticks no matter how long the loop body took.*/
+void __svc(OS_SVC_SLEEP_UNTIL) OS_sleepUntil(uint32_t * last_wake_tick, uint32_t period);
+
 void __svc(OS_RESOURCE_ACQUIRED) OS_notify_resource_aquired(OS_mutex_t * _resource);
 
+/* Changes the base priority of a task that has been added to the scheduler (use OS_setPriority() below, it returns the result).
+   A priority the task inherited through a mutex stays in effect as long as it is higher than the new base priority.*/
+void __svc(OS_SVC_SET_PRIORITY) __OS_setPriority(OS_TCB_t * task, uint32_t priority);
+uint32_t OS_setPriority(OS_TCB_t * task, uint32_t priority);
+
+/* Fork/join. A task made joinable with OS_setTaskJoinable() (call after OS_initialiseTCB() and before OS_addTask()) is not reclaimed
+   by the scheduler when it exits. Exactly one other task must call OS_join() for it instead: it blocks until the task exited (by
+   returning or by calling OS_exit()), receives its exit value and hands its TCB and stack (both from OS_alloc()) back to the
+   memcluster before it returns. RETURNS: 1 on success, 0 if task is NULL, the calling task or not joinable.*/
+void OS_setTaskJoinable(OS_TCB_t * TCB);
+void OS_exit(uint32_t exitValue);
+uint32_t OS_join(OS_TCB_t * task, uint32_t * result);
+
+/* Parks a task (which may be the calling task) until OS_resume() is called for it. A suspended task is never selected and costs the
+   scheduler nothing. A task that is sleeping or waiting when it is suspended keeps doing so, once it is woken it stays parked until it is
+   resumed. NOTE: a suspended task keeps every mutex it holds. Use OS_suspend()/OS_resume() below, they return the result.*/
+void __svc(OS_SVC_SUSPEND) __OS_suspend(OS_TCB_t * task);
+void __svc(OS_SVC_RESUME) __OS_resume(OS_TCB_t * task);
+uint32_t OS_suspend(OS_TCB_t * task);
+uint32_t OS_resume(OS_TCB_t * task);
+
+/* SVC delegate for periodic tasks to signal that the job of the current period is done, the task does not run again until its next
+   job is released (see edfScheduler.h)*/
+void __svc(OS_SVC_WAIT_NEXT_PERIOD) OS_waitForNextPeriod(void);
+
 //=============================================================================
 // channel manager svc
 //=============================================================================
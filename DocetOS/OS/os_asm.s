@@ -10,6 +10,7 @@
 ; Import global variables
     IMPORT _currentTCB
     IMPORT _OS_scheduler
+    IMPORT _OS_idleSleepEnabled
 
 ; Import SVC routines
     IMPORT _svc_OS_enable_systick
@@ -24,6 +25,12 @@
 	IMPORT _svc_OS_channelManager_disconnect
 	IMPORT _svc_OS_channelManager_checkAlive
 	IMPORT _svc_OS_resource_acquired
+	IMPORT _svc_OS_wait_next_period
+	IMPORT _svc_OS_sleepUntil
+	IMPORT _svc_OS_notifyOne
+	IMPORT _svc_OS_setPriority
+	IMPORT _svc_OS_suspend
+	IMPORT _svc_OS_resume
     
 SVC_Handler
     ; Link register contains special 'exit handler mode' code
@@ -60,6 +67,12 @@ SVC_tableStart
 	DCD _svc_OS_channelManager_disconnect
 	DCD _svc_OS_channelManager_checkAlive
 	DCD _svc_OS_resource_acquired
+	DCD _svc_OS_wait_next_period
+	DCD _svc_OS_sleepUntil
+	DCD _svc_OS_notifyOne
+	DCD _svc_OS_setPriority
+	DCD _svc_OS_suspend
+	DCD _svc_OS_resume
 SVC_tableEnd
 
     ALIGN
@@ -120,10 +133,13 @@ _task_init_switch
     ; It causes a switch to a runnable task, if possible
     SVC     0x04
 _idle_task
-    ; The following line is commented out because it doesn't play nicely with the debugger.
-    ; For deployment, uncomment this line and the CPU will sleep when idling, waking only to
-    ; handle interrupts.
-;   WFI
+    ; WFI doesn't play nicely with the debugger, so the CPU only sleeps when idling (waking
+    ; only to handle interrupts) if OS_TICKLESS_IDLE is set in os.h.
+    LDR     r0, =_OS_idleSleepEnabled
+    LDR     r0, [r0]
+    CMP     r0, #0
+    BEQ     _idle_task
+    WFI
     B       _idle_task
     
     ALIGN
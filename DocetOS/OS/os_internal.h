@@ -23,10 +23,15 @@ typedef struct {
 extern OS_TCB_t * volatile _currentTCB;
 
 /* svc */
-void __svc(OS_SVC_EXIT) _OS_task_exit(void);
+void __svc(OS_SVC_EXIT) _OS_task_exit(uint32_t exitValue);
 
 /* C */
-void _OS_task_end(void);
+void _OS_task_end(uint32_t exitValue);
+
+/* Memory of exited tasks, used by the schedulers (see os.c) */
+void OS_reclaimTask(OS_TCB_t * task);
+void OS_reclaimTaskLater(OS_TCB_t * task);
+void OS_reclaimCompletedTasks(void);
 
 /* asm */
 void _task_switch(void);
@@ -0,0 +1,23 @@
+#include "prng.h"
+
+uint32_t _OS_prngState = PRNG_DEFAULT_SEED;
+
+/* seed the PRNG was last seeded with, kept so that it can be logged and a scheduling trace reproduced later on*/
+static uint32_t _seed = PRNG_DEFAULT_SEED;
+
+/* (re)seeds the kernel PRNG. Seeding with the same value makes the scheduler repeat the exact same sequence of random choices,
+so calling this between OS_init() and OS_start() with a logged seed reproduces a scheduling trace.
+
+NOTE: xorshift gets stuck on a state of 0, a seed of 0 is therefore replaced by PRNG_DEFAULT_SEED*/
+void OS_prng_seed(uint32_t _newSeed){
+	if(_newSeed == 0){
+		_newSeed = PRNG_DEFAULT_SEED;
+	}
+	_seed = _newSeed;
+	_OS_prngState = _newSeed;
+}
+
+/* RETURNS: the seed the PRNG was last seeded with*/
+uint32_t OS_prng_getSeed(void){
+	return _seed;
+}
@@ -0,0 +1,32 @@
+#ifndef DOCETOS_PRNG_H
+#define DOCETOS_PRNG_H
+
+#include <stdint.h>
+
+/* seed used by the scheduler unless OS_prng_seed() is called. Fixed so that two runs of the same program make the same
+ * scheduling decisions.*/
+#define PRNG_DEFAULT_SEED 0x2545F491UL
+
+/* state of the kernel PRNG, only to be touched through the functions below*/
+extern uint32_t _OS_prngState;
+
+/* xorshift32 (Marsaglia). A few shifts and xors, no division and no call into libc, so it is cheap enough to be used on every
+ * task switch. Not suitable for anything security related.
+ *
+ * RETURNS: the next 32bit pseudo random number (never 0)*/
+static __inline uint32_t OS_prng_next(void){
+	uint32_t x = _OS_prngState;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	_OS_prngState = x;
+	return x;
+}
+
+//=============================================================================
+// Exported Functions
+//=============================================================================
+void OS_prng_seed(uint32_t _newSeed);
+uint32_t OS_prng_getSeed(void);
+
+#endif //DOCETOS_PRNG_H
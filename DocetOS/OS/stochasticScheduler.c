@@ -4,40 +4,46 @@
 // vars
 //=============================================================================
 
-//FLAGS
-static uint32_t systick_rollover_detected_FLAG = 0;
-
-//TASK HEAP RELATED
-static OS_minHeap_t * schedulerHeap;
-/*waitingTasksHashTable_reasonAsKey
-holds the TCB of all tasks that have entered the waiting state.
-
-NOTE: a task being in this hashtable does not mean it is not present in the heap !! the scheduler only removes waiting tasks from the 
-heap if it attempts to select them during task switch. This is to save cycles that would otherwise be wasted removing every single task from the
-heap that is waiting and restoring the heap property. As long as task is not selected it is ok for it to be in the heap, it might wake up before the
-the heap gets around to removing it.
-
- NOTE: keys in this hashtable are the reason of why the task is waiting. This allows quick access to all tasks that are waiting for a specific resource*/
-static OS_hashtable_t * waitingTasksHashTable_reasonAsKey;
-static OS_hashtable_t * waitingTasksHashTable_tcbAsKey;/* allows quick access to specific task that is waiting which is not possible via
- * waitingTasksHashTable_reasonAsKey since the reason for waiting is used as the key. both waitingTasksHashTable_tcbAsKey and waitingTasksHashTable_reasonAsKey
- * are identical in terms of the tcb pointers they contain. waitingTasksHashTable_tcbAsKey has the _reason as value corresponding to the key*/
-/*activeTasksHashTable
-holds the TCB of all tasks that are currently active and can be selected by the scheduler*/
-static OS_hashtable_t * activeTasksHashTable;
-/*tasksInSchedulerHeapHashTable
-keeps track of all tasks that are in the heap, active or otherwise. This is needed to prevent a task that exits the waiting state getting
-added to the heap even though it was never removed in the first place.*/
-static OS_hashtable_t * tasksInSchedulerHeapHashTable;
-
-//SLEEP HEAP RELATED
-static OS_minHeap_t * sleepHeap;
-/*Keeps track of tasks that requested sleep. tasks that requested sleep but have not been encountered by the scheduler (trying to run the task that has requested sleep)
-might remain in the scheduler heap (might never leave it if their sleep time expires before scheduler encounters them, in which case scheduler will unset sleep state and 
-remove the task from this hashtable).*/
-static OS_hashtable_t * sleepingTasksHashTable;
-
-static OS_TCB_t * comletedTasksLinkedList = NULL; /*stores tasks that are ready for deallocation*/
+//READY QUEUE RELATED
+/*task groups
+every task belongs to a group (defaultGroup unless OS_setTaskGroup was called) and every group has its own readyQueue. The scheduler
+first picks a group, with a chance proportional to its share among the groups that have ready tasks and cpu budget left, and then a
+task inside the group (see OS_readyQueue_sampleLevel). A group that spawns many tasks therefore does not take more of the cpu, its
+tasks split the share of the group between them.
+
+readyQueue (one per group)
+holds one intrusive list per priority level plus a bitmap of the non empty levels. The scheduler samples a level from the bitmap
+and runs the task at the head of that level, so selection does not depend on how many tasks are in the queue.*/
+static OS_taskGroup_t * defaultGroup;
+static OS_taskGroup_t * groupsLinkedList = NULL;
+/*background band
+a group that is not part of groupsLinkedList, so it never takes part in the lottery between the groups. Its tasks only run when no
+task of any other group can run (instead of the idle task), and they are picked in strict priority order, taking turns within a level.
+A foreground task that becomes runnable preempts a background task straight away, so housekeeping never delays foreground work.*/
+static OS_taskGroup_t * backgroundGroup;
+/*weight function applied to the readyQueue of every group, including groups created later on*/
+static uint32_t (* weightOfPriority)(uint32_t _priority) = OS_stochastic_defaultWeight;
+/*NOTE: waiting tasks are not held by the scheduler at all. Every object a task can wait on embeds a wait list (see waitList.c) that
+keeps its waiters in priority order, so wait and notify go straight to the waiters of that object.
+
+NOTE: which state a task is in (active, waiting, sleeping) is recorded in the state bits of its TCB, see OS_scheduler_isTaskActive()*/
+/*NOTE: whether a task is linked into the readyQueue (active or otherwise) is recorded in its TCB (see OS_readyQueue_contains). This is
+needed to prevent a task that exits the waiting state getting added to the ready queue even though it was never removed in the first place.*/
+
+//SLEEP RELATED
+/*sleepWheel
+holds every sleeping task keyed by the absolute tick at which it has to wake up. Inserting a task and expiring the tasks of a tick are both O(1),
+and since wake ticks are compared wrap-safe a rollover of the tick counter needs no special treatment.*/
+static OS_timingWheel_t * sleepWheel;
+
+/*tick at which the running task was selected, the task is charged for the time since then when it is switched out*/
+static uint32_t runningTaskStartTick = 0;
+
+/*highest priority task that was woken since the last task switch and outranks the running task, it is run next (see __preemptIfOutranks)*/
+static OS_TCB_t * preemptingTask = NULL;
+
+/*summed recentUsage of the groups in groupsLinkedList*/
+static uint32_t groupsRecentUsage = 0;
 
 //=============================================================================
 // prototypes
@@ -49,19 +55,42 @@ static void stochasticScheduler_addTask(OS_TCB_t * const tcb,uint32_t task_prior
 static void stochasticScheduler_taskExit(OS_TCB_t * const tcb);
 static void stochasticScheduler_waitCallback(void * const _reason, uint32_t checkCode,uint32_t _isReasonMutex);
 static void stochasticScheduler_notifyCallback(void * const reason);
+static void stochasticScheduler_notifyOneCallback(void * const reason, uint32_t _isReasonMutex);
 static void stochasticScheduler_sleepCallback(OS_TCB_t * const tcb,uint32_t min_sleep_duration);
+static void stochasticScheduler_sleepUntilCallback(OS_TCB_t * const tcb,uint32_t wake_tick);
+static uint32_t stochasticScheduler_ticksUntilNextWakeup(void);
 static void resourceAcquired_callback( OS_mutex_t * _resource);
+static uint32_t stochasticScheduler_setPriority(OS_TCB_t * const tcb, uint32_t task_priority);
+static uint32_t stochasticScheduler_suspend(OS_TCB_t * const tcb);
+static uint32_t stochasticScheduler_resume(OS_TCB_t * const tcb);
 
 //internal
-static int __getRandForTaskChoice(void);
-static uint32_t __removeIfWaiting(uint32_t _index);
-static uint32_t __removeIfSleeping(uint32_t _index);
-static uint32_t __removeIfExit(uint32_t _index);
-static uint32_t __updateSleepState(OS_TCB_t * task);
-static void __updatePriorityInheritance(OS_TCB_t * task);
+static uint32_t __getRandForTaskChoice(void);
+static uint32_t __removeIfWaiting(OS_TCB_t * task);
+static uint32_t __removeIfSleeping(OS_TCB_t * task);
+static uint32_t __removeIfExit(OS_TCB_t * task);
+static void __wakeTask(OS_TCB_t * task);
+static void __makeWaiterReady(OS_TCB_t * task);
+static OS_readyQueue_t * __readyQueueOf(OS_TCB_t * task);
+static OS_taskGroup_t * __sampleGroup(uint32_t random);
+static OS_taskGroup_t * __newGroup(uint32_t share);
+static uint32_t __isForegroundReady(void);
+static OS_TCB_t * __selectBackgroundTask(void);
+static uint32_t __groupHasBudget(OS_taskGroup_t * group);
+static void __chargeGroup(OS_taskGroup_t * group, uint32_t ticksRun);
+static uint32_t __isGroupUnderShare(OS_taskGroup_t * group);
+static void __preemptIfOutranks(OS_TCB_t * task);
+static void __releaseAcquiredResource(OS_TCB_t * task, void * resource);
+static uint32_t __quantumOf(OS_TCB_t * task);
+static uint32_t __hasRemainingExecutionTime(OS_TCB_t * task, uint32_t ticksRun);
+static void __adaptPriority(OS_TCB_t * task, uint32_t ticksRun);
+static void __replenishBudgetIfDue(OS_TCB_t * task);
+static void __chargeTask(OS_TCB_t * task, uint32_t ticksRun);
+static uint32_t __updatePriorityInheritance(OS_TCB_t * task);
+static uint32_t __updatePriorityInheritanceFrom(OS_TCB_t * task, uint32_t prevEffectivePriority);
+static uint32_t __effectivePriority(OS_TCB_t * task);
 
 //debug
-static void DEBUG_hashTableState(void);
 static void DEBUG_heapState(void);
 
 //=============================================================================
@@ -71,187 +100,129 @@ static void DEBUG_heapState(void);
 /*scheduler struct init*/
 OS_Scheduler_t const stochasticScheduler = {
 		.preemptive = 1,
+		.init_callback = initialize_scheduler,
 		.scheduler_callback = stochasticScheduler_scheduler,
 		.addtask_callback = stochasticScheduler_addTask,
 		.taskexit_callback = stochasticScheduler_taskExit,
 		.wait_callback = stochasticScheduler_waitCallback,
 		.notify_callback = stochasticScheduler_notifyCallback,
+		.notifyOne_callback = stochasticScheduler_notifyOneCallback,
 		.sleep_callback = stochasticScheduler_sleepCallback,
-        .resourceAcquired_callback =resourceAcquired_callback
+        .resourceAcquired_callback =resourceAcquired_callback,
+		.ticksUntilNextWakeup_callback = stochasticScheduler_ticksUntilNextWakeup,
+		.sleepUntil_callback = stochasticScheduler_sleepUntilCallback,
+		.setPriority_callback = stochasticScheduler_setPriority,
+		.suspend_callback = stochasticScheduler_suspend,
+		.resume_callback = stochasticScheduler_resume
 };
 
-void initialize_scheduler(uint32_t _sizeOfHeapNodeArray){
-	/* initializing heaps needed to keep track of tasks in various states. Carefull consideration needs to be taken
-	when deciding on the capacity of these hashtables since if they are too small it might prevent wait() and sleep() from working
-	(task cant be removed from heap if there is no space in waitingTasksHashTable_reasonAsKey since the pointer to the TCB would be lost)
-	
-	choosing the bucket size is not as important, but fewer buckets lead to increased item access time*/
-	waitingTasksHashTable_reasonAsKey = new_hashtable(WAIT_HASHTABLE_CAPACITY,NUM_BUCKETS_FOR_WAIT_HASHTABLE);
-	waitingTasksHashTable_tcbAsKey = new_hashtable(WAIT_HASHTABLE_CAPACITY,NUM_BUCKETS_FOR_WAIT_HASHTABLE);
-	activeTasksHashTable = new_hashtable(WAIT_HASHTABLE_CAPACITY,NUM_BUCKETS_FOR_WAIT_HASHTABLE);
-	tasksInSchedulerHeapHashTable = new_hashtable(WAIT_HASHTABLE_CAPACITY,NUM_BUCKETS_FOR_WAIT_HASHTABLE);
-	sleepingTasksHashTable = new_hashtable(WAIT_HASHTABLE_CAPACITY,NUM_BUCKETS_FOR_WAIT_HASHTABLE);
-	//other init stuff
-	schedulerHeap = new_heap(_sizeOfHeapNodeArray,1);
-	sleepHeap = new_heap(_sizeOfHeapNodeArray,0);
-	srand(OS_elapsedTicks());//pseudo random num, ok since this is not security related so don't really care
+void initialize_scheduler(uint32_t _initialTaskCapacity){
+	/*the readyQueue, the wait lists and the sleepWheel all link the tasks through fields in their TCBs, so none of them has a capacity
+	that could run out and _initialTaskCapacity is not needed*/
+	defaultGroup = OS_stochastic_newTaskGroup(STOCHASTIC_DEFAULT_GROUP_SHARE);
+	backgroundGroup = __newGroup(0);
+	sleepWheel = new_timingWheel(OS_elapsedTicks());
+	OS_prng_seed(PRNG_DEFAULT_SEED);//fixed seed so scheduling is reproducible, call OS_prng_seed() after OS_init() to change it
 }
 
 //=============================================================================
 // SCHEDULER FUNCTION
 //=============================================================================
 /* Determines which of the AWAKE and NOT WAITING tasks should be executed. The choice of task is RANDOM,
-but the probability of each task being selected corresponds to its position in the heap. So tasks with a low priority 
-(low down in the heap) will have a small but non-zero chance of getting cpu time.
+but the probability of each task being selected corresponds to its priority level in the ready queue. So tasks with a low priority
+will have a small but non-zero chance of getting cpu time.
 */
 static OS_TCB_t const * stochasticScheduler_scheduler(void){
-	static int ticksSinceLastTaskSwitch = 0;// used to force task to yield after MAX_TASK_TIME_IN_SYSTICKS
 	OS_TCB_t * currentTaskTCB = OS_currentTCB();
+	uint32_t ticksRun = OS_elapsedTicks() - runningTaskStartTick;
 	
-	/*check if task has yielded, is waiting, sleeping or has exited. If not then force it to yield if it has exceeded max allowed task time.
-	Otherwise allow it to continue running.*/
+	/*The following block advances the sleepWheel up to the current tick and wakes every task whose wake tick has been reached. These tasks
+	have their SLEEP state cleared and are added back to the readyQueue. Ticks at which no task
+	wakes cost nothing beyond a bitmap check. This runs on every tick (not only on task switches), so a woken task that outranks the
+	running task preempts it on the tick it wakes at.*/
+	OS_timingWheelNode_t * wokenNode = OS_timingWheel_advance(sleepWheel,OS_elapsedTicks());
+	while(wokenNode){
+		OS_TCB_t * wokenTask = (OS_TCB_t *)wokenNode->ptrToNodeContent;
+		wokenNode = wokenNode->next;
+		__wakeTask(wokenTask);
+	}
+	
+	/*check if task has yielded, is waiting, sleeping or has exited. If not then force it to yield if it has used up its quantum or its
+	cpu budget, or if a task that outranks it has been woken (for a background task: if any foreground task can run). Otherwise allow it
+	to continue running.*/
 	if( currentTaskTCB != OS_idleTCB_p ){
 		uint32_t isCurrentTaskDone = currentTaskTCB->state & TASK_STATE_EXIT;
-		uint32_t hasTaskStateChanged = currentTaskTCB->state & (TASK_STATE_YIELD | TASK_STATE_WAIT | TASK_STATE_SLEEP);
-		uint32_t hasRemainingExecutionTime = ticksSinceLastTaskSwitch < MAX_TASK_TIME_IN_SYSTICKS;
-		ticksSinceLastTaskSwitch += 1;
-		if(!isCurrentTaskDone && !hasTaskStateChanged && hasRemainingExecutionTime){
+		uint32_t hasTaskStateChanged = currentTaskTCB->state & (TASK_STATE_YIELD | TASK_STATE_WAIT | TASK_STATE_SLEEP | TASK_STATE_SUSPENDED);
+		uint32_t isDisplaced = currentTaskTCB->taskGroup == backgroundGroup && __isForegroundReady();
+		if(!isCurrentTaskDone && !hasTaskStateChanged && !preemptingTask && !isDisplaced && __hasRemainingExecutionTime(currentTaskTCB,ticksRun)){
 			//task is allowed to continue running
 			return currentTaskTCB;
 		}
-	}
-	
-	/*free resources associated with tasks that have run to completion. These reources might not have yet been freed. This could be caused
-	by the memcluster being in use at the time.*/
-	if(comletedTasksLinkedList){
-		__disable_irq();
-		if(!OS_isMemclusterInUse()){
-				while(comletedTasksLinkedList){
-				OS_TCB_t * taskToDealloc = comletedTasksLinkedList;
-				comletedTasksLinkedList = (OS_TCB_t *)taskToDealloc->data;
-				/* CRITICAL SECTION START
-				-> preventing internal mutexes of the memory cluster using svc callbacks
-				-> disable interrupts whilst svc callbacks of locks are disabled*/
-				memory_cluster_setInternalLockState(0);
-				OS_free((uint32_t*)taskToDealloc->originalSpMemoryPointer);
-				OS_free((uint32_t*)taskToDealloc);
-				memory_cluster_setInternalLockState(1);
-				/* CRITICAL SECTION END*/
-			}
+		/*the task is switched out, adapt its priority to how it used the cpu and charge it for the time it ran (this might throttle it)*/
+		if(!isCurrentTaskDone){
+			__adaptPriority(currentTaskTCB,ticksRun);
+			__chargeTask(currentTaskTCB,ticksRun);
 		}
-		__enable_irq();
 	}
 	
+	/*free resources associated with tasks that have run to completion in earlier runs (the task switched away from now is only queued
+	below, see OS_reclaimTaskLater). These resources might not have been freed yet because the memcluster was in use.*/
+	OS_reclaimCompletedTasks();
+	
 	/*Task has either yielded, exited or is sleeping/waiting or it exceeded its maximum allowed time, switch task*/
-	//reset YIELD state and task switch counter
-	currentTaskTCB->state &= ~TASK_STATE_YIELD;// reset so task has chance of running after next task switch
+	if(currentTaskTCB->state & TASK_STATE_EXIT){
+		/*unlinked now, freed on the next run since the context switch still writes to its stack and TCB (with SCHEDULER_EAGER_READY_SET
+		it was unlinked when it exited already)*/
+		if(OS_readyQueue_contains(currentTaskTCB)){
+			OS_readyQueue_remove(__readyQueueOf(currentTaskTCB),currentTaskTCB);
+		}
+		OS_reclaimTaskLater(currentTaskTCB);
+	}else{
+		currentTaskTCB->state &= ~TASK_STATE_YIELD;// reset so task has chance of running after next task switch
+	}
 	/*not resetting TASK_STATE_SLEEP or TASK_STATE_WAIT, these are reset elswhere upon certain conditions (i.e a lock getting released)
 	occurring*/
-	ticksSinceLastTaskSwitch = 0; //set to 0 so that next task can run for MAX_TASK_TIME_IN_SYSTICKS
-	
-	/*A rollover of the systick counter might have happened. If this is the case then the timestamp of when a task started to
-	sleep needs to be adjusted becaus otherwise it might happen that a task has gone to sleep at 513 ticks but the current tick is 11, which means
-	that the elapsed time since the task went to sleep is -502 ticks.
+	runningTaskStartTick = OS_elapsedTicks(); //so that the next task can run for its full quantum
 	
-	The following block UPDATES THE SLEEP STATE OF ALL SLEEPING TASKS, regardless of their location (sleepHeap or schedulerHeap)*/
-	if(systick_rollover_detected_FLAG){
-		/*cycle through all sleeping tasks and adjust their timestamp and remaining time*/
-		for(int bucketInd=0;bucketInd<sleepingTasksHashTable->numberOfBuckets;bucketInd++){
-			const OS_hashtable_value_t * element = OS_hashtable_getFirstElementOfNthBucket(sleepingTasksHashTable,bucketInd);
-			while(element){
-				OS_TCB_t * sleepingTask = (OS_TCB_t *)element->underlyingData;
-				__updateSleepState(sleepingTask);
-				element = (OS_hashtable_value_t *)element->nextHashtableValue;
-			}
+	/*a woken task that outranked the running task is run straight away (unless it stopped being runnable in the meantime)*/
+	OS_TCB_t * selectedTCB = NULL;
+	if(preemptingTask){
+		OS_TCB_t * task = preemptingTask;
+		preemptingTask = NULL;
+		if(!(task->state & (TASK_STATE_WAIT | TASK_STATE_SLEEP | TASK_STATE_EXIT | TASK_STATE_THROTTLED | TASK_STATE_SUSPENDED)) && OS_readyQueue_contains(task)
+				&& __groupHasBudget((OS_taskGroup_t *)task->taskGroup)){
+			selectedTCB = task;
 		}
-		/*reset flag*/
-		systick_rollover_detected_FLAG = 0;
 	}
-	/*The following block removes the first node of the sleepHeap and updates its sleep state (remaining time etc), if this node
-	is found to have woken it is removed from the sleepingTasksHashTable and added back to the activeTasksHashTable, tasksInSchedulerHeapHashTable
-	and the schedulerHeap. If it has not woken it is simply added back to the sleepHeap and the block exits (if the top node is not awake then
-	no other node will be awake either).
 	
-	It is important to note that this block ONLY UPDATES SLEEPING TASKS IN THE SLEEP HEAP, nodes that are asleep but have not been
-	removed from the schedulerHeap (nodes present in sleepingTasksHashTable, tasksInSchedulerHeapHashTable and schedulerHeap but not in sleepHeap) are dealt with
-	later in the scheduler function.*/
-	void * sleepingTask;
-	while(1){
-		if(!OS_heap_removeNode(sleepHeap,&sleepingTask)){
-			break;/*No nodes on the heap to wake*/
+	/*Is there any active task to run in the ready queue (THIS MUST RUN AFTER UPDATING SLEEP STATE! DONT MOVE THIS!)?*/
+	/*Select random task to give cpu time to. First a group is picked according to the shares of the groups (see __sampleGroup), then a
+	task of that group (probability of each task being selected proportional to the weight of its priority, see OS_stochastic_setWeightFunction).
+	A single random number selects the level, the level is found in log2(READY_QUEUE_NUM_LEVELS) steps*/
+	while(selectedTCB == NULL){
+		OS_taskGroup_t * group = __sampleGroup(__getRandForTaskChoice());
+		if(group == NULL){
+			break;// no group with ready tasks and budget left
 		}
-		//sleepingTask now points to task from sleepHeap with lowest remaining sleep time
-		if(__updateSleepState((OS_TCB_t*)sleepingTask)){
-			/*task still asleep add it back to the sleep heap with updated priority. since the priority in the sleep heap is given
-			by the tasks remaining sleep time we can stop here. If this task (which was at the top of the heap)
-			is still sleeping then all others will also be still asleep*/
-			OS_heap_addNode(sleepHeap,sleepingTask,((OS_TCB_t*)sleepingTask)->data2);
-			break;
+		uint32_t level = OS_readyQueue_sampleLevel(group->readyQueue,__getRandForTaskChoice());
+		/*tasks that share a level take turns, the head of the level is selected and moved to the back of the level*/
+		OS_TCB_t * task = OS_readyQueue_rotateLevel(group->readyQueue,level);
+		/*remove the task if it is waiting, sleeping or has exited and sample again (with SCHEDULER_EAGER_READY_SET these
+		tasks were already unlinked when they changed state, so the first sample is always runnable)*/
+		if(__removeIfExit(task) || __removeIfWaiting(task) || __removeIfSleeping(task)){
+			continue;
 		}
-	}	
-	
-	
-	/*Is there any active task to run in the heap (THIS MUST RUN AFTER UPDATING SLEEP STATE! DONT MOVE THIS!)?*/
-	if(schedulerHeap->currentNumNodes == 0){
-		return OS_idleTCB_p;// no active tasks currently (maybe all sleeping).
+		selectedTCB = task;
+		break;
 	}
-	/*Select random task to give cpu time to (probability of each task being selected based on its position in heap)*/
-	OS_TCB_t * selectedTCB = NULL;
-	{
-		int randNodeSelection;
-		int nodeIndex = 0; //starting with highest priority node
-		int maxValidHeapIdx = schedulerHeap->currentNumNodes - 1;
-		int lastActiveNodeIndex = 0;
-		while(1){
-			/*remove the current node if the task is waiting or sleeping*/
-			if(__removeIfExit(nodeIndex) || __removeIfWaiting(nodeIndex) || __removeIfSleeping(nodeIndex) ){
-				//waiting/sleeping node removed
-				maxValidHeapIdx = schedulerHeap->currentNumNodes - 1;
-				/*after removal of node there might be none left in which case we need to stop and return idle task*/
-				if(schedulerHeap->currentNumNodes == 0){
-					return OS_idleTCB_p;// no active tasks currently (maybe all sleeping).
-				}
-				/*after removing a waiting/sleeping node at this index it turns out that this index no longer
-					lies within the valid heap, return the last not sleeping task encountered in the heap*/
-				if(nodeIndex > maxValidHeapIdx){
-					return schedulerHeap->ptrToUnderlyingArray[lastActiveNodeIndex].ptrToNodeContent;
-				}
-				/*sleeping or waiting node has been removed and the heap has been restored, this means that we need to
-				rerun for the same index to check if the new node at the current index is sleeping or waiting*/
-				continue;
-			}else{
-				/*we know the node at this index is neither sleeping or waiting, we can use it as a fallback for selection in case
-				all of its children are sleeping or waiting*/
-				lastActiveNodeIndex = nodeIndex;
-			}
-			/*Making the choice if the current node should be selected or if we should try and select one if its children (if the child
-			is valid and not waiting or sleeping)*/
-			randNodeSelection = __getRandForTaskChoice();
-			if(!randNodeSelection){
-				/*Current node selected (randNodeSelection==0). We previously checked that node at nodeIndex is not sleeping or waiting
-				so we can be sure that current node is valid and stop the search here*/
-				break;
-			}
-			/*current node not selected (randNodeSelection != 0), one of its children has been selected. check if node has valid child node*/
-			int nextNodeIdx;
-			if(randNodeSelection == 1){//left child
-				nextNodeIdx = OS_heap_getFirstChildIndex(nodeIndex);
-			}else{//right child
-				nextNodeIdx = OS_heap_getSecondChildIndex(nodeIndex);
-			}
-			//check if selected child is valid node
-			if (nextNodeIdx <= maxValidHeapIdx){
-				nodeIndex = nextNodeIdx;
-				continue;
-			}else{
-				break;//nodeIndex not updated, so current node is selected for cpu time
-			}
-		}
-		selectedTCB = schedulerHeap->ptrToUnderlyingArray[nodeIndex].ptrToNodeContent;
+	
+	/*no foreground task can run, give the cpu to the background band before falling back to the idle task*/
+	if(selectedTCB == NULL){
+		selectedTCB = __selectBackgroundTask();
 	}
 	
 	if(selectedTCB == NULL){
-		return OS_idleTCB_p;
+		return OS_idleTCB_p;// no active tasks currently (maybe all sleeping).
 	}else{
 		return selectedTCB;
 	}
@@ -261,9 +232,8 @@ static OS_TCB_t const * stochasticScheduler_scheduler(void){
 // Task related function definitions
 //=============================================================================
 
-/* Adds task control block to the heap at a position determined by the specified priority.
+/* Adds task control block to the ready queue at the level determined by the specified priority.
 Depending on the given priority the task has a higher or lower probability of being given cpu time.
-NOTE: Schould there be no space on the heap the task is not added.
 */
 static void stochasticScheduler_addTask(OS_TCB_t * const tcb,uint32_t task_priority){
 	if(tcb == NULL){
@@ -279,13 +249,13 @@ static void stochasticScheduler_addTask(OS_TCB_t * const tcb,uint32_t task_prior
 		ASSERT(0);
 		return;
 	}
+	/*TASK_STATE_SCHEDULED makes the state non zero, so the same task can not be added to the scheduler twice*/
+	tcb->state = TASK_STATE_SCHEDULED;
 	tcb->priority = task_priority;
-	OS_hashtable_put(activeTasksHashTable,(uint32_t)tcb,(uint32_t*)tcb,HASHTABLE_REJECT_MULTIPLE_VALUES_PER_KEY);
-	OS_hashtable_put(tasksInSchedulerHeapHashTable,(uint32_t)tcb,(uint32_t*)tcb,HASHTABLE_REJECT_MULTIPLE_VALUES_PER_KEY);
-	if ( !OS_heap_addNode(schedulerHeap,tcb,task_priority)) {
-		/*HASHTABLE_REJECT_MULTIPLE_VALUES_PER_KEY prevent the same task (TCB=key) being added multiple times to the scheduler */
-		printf("\r\nSCHEDULER: unable to add task (TCB:%p) with priority %d to scheduler. (scheduler task num= %d)\r\n",tcb,task_priority,schedulerHeap->currentNumNodes);
+	if(tcb->taskGroup == NULL){
+		tcb->taskGroup = defaultGroup;// membership is fixed from here on
 	}
+	OS_readyQueue_add(__readyQueueOf(tcb),tcb,task_priority);
 }
 
 
@@ -300,110 +270,137 @@ static void stochasticScheduler_addTask(OS_TCB_t * const tcb,uint32_t task_prior
 static void stochasticScheduler_taskExit(OS_TCB_t * const tcb){
     tcb->state |= TASK_STATE_EXIT;
 		tcb->data = NULL; // used in completed tasks linked list. Needs to be NULL if not pointing to other completed task
+#if SCHEDULER_EAGER_READY_SET
+		/*unlink the task now, the scheduler queues its memory for reclaiming when it switches away from it. Freeing it here is not
+		possible since the task is still executing on its stack.*/
+		OS_readyQueue_remove(__readyQueueOf(tcb),tcb);
+#else
+		if(tcb->joinable){
+			OS_readyQueue_remove(__readyQueueOf(tcb),tcb);// OS_join() frees the task, it must not be linked anywhere by then
+		}
+#endif
     /*It would be easy to release all mutexes held by the task here...not sure if advisable since the user might make a mistake
 			whilst setting up a task which causes it to exit before releasing the locks. If I release the locks automatically it would
 			hide the actual problem of the task exiting too soon, which in turn could make it a lot harder to debug.*/
 }
 
+/* parks a task: it is unlinked from the ready queue (O(1)) and every path that makes tasks ready again (notify, sleep expiry, budget
+replenishment) leaves it out as long as TASK_STATE_SUSPENDED is set, so the scheduler never sees it. A sleeping or waiting task stays in
+the sleepWheel or wait list and keeps its place there. Suspending the running task switches away from it (see _svc_OS_suspend).
+
+RETURNS: 1 on success (also if the task was suspended already), 0 if the task is not scheduled or is the idle task*/
+static uint32_t stochasticScheduler_suspend(OS_TCB_t * const tcb){
+	if(tcb == NULL || tcb == OS_idleTCB_p || !(tcb->state & TASK_STATE_SCHEDULED) || (tcb->state & TASK_STATE_EXIT)){
+		printf("\r\nSCHEDULER: ERROR, cannot suspend task %p, it is not scheduled!\r\n",tcb);
+		return 0;
+	}
+	tcb->state |= TASK_STATE_SUSPENDED;
+	OS_readyQueue_remove(__readyQueueOf(tcb),tcb);
+	if(preemptingTask == tcb){
+		preemptingTask = NULL;
+	}
+	return 1;
+}
+
+/* undoes OS_suspend(). The task goes back into the ready queue unless it is still sleeping or throttled, in which case the usual wake
+path adds it once it is woken. A task that is still waiting is taken out of its wait list and made ready as well: notifyOne skips
+suspended waiters, so the signal it waits for might already have gone by (e.g. a token released whilst it was parked). Every caller of
+OS_wait() checks its condition again after waking, so the task simply waits again should the condition still not hold.
+
+RETURNS: 1 on success (also if the task was not suspended), 0 if the task is not scheduled*/
+static uint32_t stochasticScheduler_resume(OS_TCB_t * const tcb){
+	if(tcb == NULL || !(tcb->state & TASK_STATE_SCHEDULED) || (tcb->state & TASK_STATE_EXIT)){
+		printf("\r\nSCHEDULER: ERROR, cannot resume task %p, it is not scheduled!\r\n",tcb);
+		return 0;
+	}
+	if(!(tcb->state & TASK_STATE_SUSPENDED)){
+		return 1;
+	}
+	tcb->state &= ~TASK_STATE_SUSPENDED;
+	if(tcb->state & TASK_STATE_WAIT){
+		OS_mutex_t * mutex = (OS_mutex_t *)tcb->waitingOnMutex;
+		OS_waitList_wake((OS_waitList_t *)tcb->waitReason,tcb);
+		__makeWaiterReady(tcb);
+		if(mutex){
+			OS_mutex_refreshWaiterPriority(mutex,__updatePriorityInheritance);// the task no longer passes its priority on to the owner
+		}
+		return 1;
+	}
+	if(tcb->state & (TASK_STATE_SLEEP | TASK_STATE_THROTTLED)){
+		return 1;
+	}
+	if(!OS_readyQueue_contains(tcb)){
+		OS_readyQueue_add(__readyQueueOf(tcb),tcb,__effectivePriority(tcb));
+	}
+	__preemptIfOutranks(tcb);
+	return 1;
+}
+
 //=============================================================================
 // wait, notify and sleep
 //=============================================================================
 
-/*Marks the current task as waitin and adds it to the hashtable that keeps track of all waiting tasks. The Task is not
-actually removed from the heap, this is done by the scheduler.*/
+/*Marks the current task as waitin and queues it in the wait list of the object it waits for. With SCHEDULER_EAGER_READY_SET the task
+is unlinked from the ready queue straight away, otherwise it is removed by the scheduler once it samples the task.*/
 static void stochasticScheduler_waitCallback(void * const _reason, uint32_t checkCode,uint32_t _isReasonMutex){
-	if (checkCode != OS_checkCode()){
+	if (checkCode != OS_checkCode(_reason)){
 		return;//checkcode mismatch, notify called during function that uses wait
 	}
 	//printf("\r\nINFO: task %p starting to wait for %p ...\r\n",OS_currentTCB(),_reason);
-	/*add current task to the waiting hash_table*/
 	OS_TCB_t * currentTCB = OS_currentTCB();
-	if(OS_hashtable_remove(activeTasksHashTable,(uint32_t)currentTCB) == NULL){
+	if(currentTCB->state & (TASK_STATE_WAIT | TASK_STATE_SLEEP | TASK_STATE_EXIT)){
 		printf("\u001b[31m\r\nSCHEDULER: ERROR, task %p requested wait for %p , but it is not an active task!\r\n",currentTCB,_reason);
-		DEBUG_hashTableState();
+		DEBUG_printWaitList((OS_waitList_t *)_reason);
 		DEBUG_heapState();
 		printf("\u001b[0m");
 		ASSERT(0);
+		return;
 	}
-	if(!OS_hashtable_put(waitingTasksHashTable_reasonAsKey,(uint32_t)_reason,(uint32_t *)currentTCB,HASHTABLE_REJECT_MULTIPLE_IDENTICAL_VALUES_PER_KEY)){
-		printf("\u001b[31m\r\nSCHEDULER: ERROR, task %p requested wait for %p , but it could not be added to the waitingTasksHashTable_reasonAsKey!\r\n",currentTCB,_reason);
-		DEBUG_hashTableState();
-		DEBUG_heapState();
-		printf("\u001b[0m");
-		ASSERT(0);
-	}else{
-		/*mirroring waitingTaskHashTable_reasonAsKey*/
-		OS_hashtable_put(waitingTasksHashTable_tcbAsKey,(uint32_t )currentTCB,(uint32_t *)_reason,HASHTABLE_REJECT_MULTIPLE_IDENTICAL_VALUES_PER_KEY);
-	}
-	/*HASHTABLE_REJECT_MULTIPLE_IDENTICAL_VALUES_PER_KEY because mutex is used as key, and the same task is allowed to wait on more than one mutex in theory,
-	but the same task cannot wait multiple times on the same mutex*/
+	OS_waitList_insert((OS_waitList_t *)_reason,currentTCB,_reason);
 	currentTCB->state |= TASK_STATE_WAIT;
+#if SCHEDULER_EAGER_READY_SET
+	OS_readyQueue_remove(__readyQueueOf(currentTCB),currentTCB);
+#endif
 
     /*start the priority inherritance */
     if(_isReasonMutex ){
         OS_mutex_t * mutex = (OS_mutex_t * ) _reason;
-        OS_TCB_t * mutexOwner = mutex->tcbPointer;
-        __updatePriorityInheritance(mutexOwner);
+        currentTCB->waitingOnMutex = mutex;
+        OS_mutex_propagateInheritance(mutex,__effectivePriority(currentTCB),__updatePriorityInheritance);
     }
 }
 
 static void stochasticScheduler_notifyCallback(void * const reason){
-	/*add all the tasks that are waiting for the given reason back to the scheduler heap*/
-	if(waitingTasksHashTable_reasonAsKey == NULL){
-		return;//during initialisation locks are released calling notify, but hash table is not created yet
-	}
-	while(1){
-		OS_TCB_t * task = (OS_TCB_t*)OS_hashtable_remove(waitingTasksHashTable_reasonAsKey,(uint32_t)reason);
-		/*mirroring waitingTasksHashTable_reasonAsKey content*/
-		OS_hashtable_remove(waitingTasksHashTable_tcbAsKey,(uint32_t)task);
-		if(task == NULL){
-			break; /*no task was waiting for _reason, this is normal behaviour*/
-		}
-		if(OS_hashtable_put(activeTasksHashTable,(uint32_t)task,(uint32_t*)task,HASHTABLE_REJECT_MULTIPLE_VALUES_PER_KEY)){
-			task->state &= ~TASK_STATE_WAIT;
-		}else{
-			printf("\u001b[31m\r\nSCHEDULER: ERROR, unable to add task %p which was previously waiting back to activeTasksHashTable!\r\n",task);
-			DEBUG_hashTableState();
-			DEBUG_heapState();
-			printf("\u001b[0m");
-			ASSERT(0);
-		}
-		
-		/*if the OS_hashtable_put(tasksInSchedulerHeapHashTable...) below fails (returns 0) that is expected behaviour. It simply means that a task
-		requested wait but that it was never removed from the schedulerHeap because the scheduler did not come accross that node in the heap
-		when searching for the next task to select (and therefore did not have a chance to remove it from the heap). */
-		if(OS_hashtable_put(tasksInSchedulerHeapHashTable,(uint32_t)task,(uint32_t*)task,HASHTABLE_REJECT_MULTIPLE_VALUES_PER_KEY)){
-			/*tcb was added to "tasksInSchedulerHeapHashTable" meaning that it currently is not in the heap (if it had never been removed from the heap
-			the OS_hashtable_put operation would have returned 0 when attempting to add it again), hence add it*/
-			if(task->inheritedPriority)
-                OS_heap_addNode(schedulerHeap,task,task->inheritedPriority);
-            else{
-                OS_heap_addNode(schedulerHeap,task,task->priority);
-            }
+	/*add all the tasks that are waiting for the given reason back to the ready queue*/
+	OS_waitList_t * waiters = (OS_waitList_t *)reason;
+	while(waiters->head){
+		OS_TCB_t * task = waiters->head;
+		if(task->waitingOnMutex == reason){
+			/*every waiter is woken, so nobody is left for the mutex to pass a priority on from*/
+			((OS_mutex_t *)reason)->maxWaiterPriority = 0;
 		}
+		OS_waitList_wake(waiters,task);
+		__makeWaiterReady(task);
 	}
-	/*This task has just released a resource. If it is currently running under inherited priority this priority needs
-	 * to be updated now to reflect this change.*/
-	OS_TCB_t * currentTCB = OS_currentTCB();
-	/*remove the released resource from the tasks linked list of acquired mutexes, (if the resource cannot be found
-	 * in that list then do nothing, priority inheritance currently only works for mutex)*/
-	OS_mutex_t * prevAcquiredMutex = NULL;
-	OS_mutex_t * acquiredMutex = currentTCB->acquiredResourcesLinkedList;
-	while (acquiredMutex){
-			if(acquiredMutex == reason){
-					/*found resource, remove it from the list since the task no longer owns it*/
-					if(prevAcquiredMutex){
-							prevAcquiredMutex->nextAcquiredResource = acquiredMutex->nextAcquiredResource;
-					}else{
-							currentTCB->acquiredResourcesLinkedList = acquiredMutex->nextAcquiredResource;
-					}
-					acquiredMutex->nextAcquiredResource = NULL;//reset to avoid infinite loop
-					__updatePriorityInheritance(currentTCB);
-					break;
-			}
-			prevAcquiredMutex = acquiredMutex;
-			acquiredMutex = acquiredMutex->nextAcquiredResource;
+	__releaseAcquiredResource(OS_currentTCB(),reason);
+}
+
+/*wakes only the highest priority task waiting for the given reason (the head of its wait list, suspended waiters are skipped, see
+stochasticScheduler_resume), the remaining waiters keep waiting
+until the next notify. A released mutex is handed to the woken task directly: tcbPointer is set to the woken task, so no other task
+can take the mutex before it runs and it acquires it without waiting again. Should another task have taken the mutex in between the
+release and this call the woken task is left waiting, the new owner notifies it once it releases the mutex (see OS_mutex_handOff).*/
+static void stochasticScheduler_notifyOneCallback(void * const reason, uint32_t _isReasonMutex){
+	OS_TCB_t * task;
+	if(_isReasonMutex){
+		task = OS_mutex_handOff((OS_mutex_t *)reason);
+	}else{
+		task = OS_waitList_wakeOne((OS_waitList_t *)reason);
 	}
+	if(task){
+		__makeWaiterReady(task);
+	}
+	__releaseAcquiredResource(OS_currentTCB(),reason);
 }
 
 static void stochasticScheduler_sleepCallback(OS_TCB_t * const tcb,uint32_t min_sleep_duration){
@@ -411,25 +408,61 @@ static void stochasticScheduler_sleepCallback(OS_TCB_t * const tcb,uint32_t min_
 	if(min_sleep_duration == 0){
 		return;
 	}
-	if(OS_hashtable_remove(activeTasksHashTable,(uint32_t)tcb)){
-		/*set task state so that the scheduler can identify tasks that requested sleep and check if this
-		condition still applies*/
-		tcb->state |= TASK_STATE_SLEEP;
-		tcb->data = OS_elapsedTicks(); /*what time did the task request the sleep ? needed to check if
-		the task should wake up.*/
-		tcb->data2 = min_sleep_duration;/*used to keep track of the remaining sleep duration*/
-		OS_hashtable_put(sleepingTasksHashTable,(uint32_t) tcb,(uint32_t*) tcb,HASHTABLE_REJECT_MULTIPLE_VALUES_PER_KEY);
-		/*task is not removed from the heap, this is done inside the scheduler callback should the scheduler try to run
-		a task that is in the sleep state.*/
-	}else{
-		/*OS_hashtable_remove returned NULL meaning that no element with the given key was present*/
-		printf("\u001b[31m\r\nSCHEDULER: ERROR task %p called sleep, but it is not in the activeTasks HashTable!\r\n",tcb);
-		DEBUG_hashTableState();
+	if(min_sleep_duration > TIMING_WHEEL_MAX_DELAY){
+		min_sleep_duration = TIMING_WHEEL_MAX_DELAY;
+	}
+	stochasticScheduler_sleepUntilCallback(tcb,OS_elapsedTicks() + min_sleep_duration);
+}
+
+/* puts the task to sleep until the absolute wake_tick (used directly by OS_sleepUntil). The sleepWheel works with absolute wake ticks
+anyway, so no time is lost converting to a duration and back.*/
+static void stochasticScheduler_sleepUntilCallback(OS_TCB_t * const tcb,uint32_t wake_tick){
+	if(tcb->state & (TASK_STATE_WAIT | TASK_STATE_SLEEP | TASK_STATE_EXIT)){
+		printf("\u001b[31m\r\nSCHEDULER: ERROR task %p called sleep, but it is not an active task!\r\n",tcb);
 		DEBUG_heapState();
 		printf("\u001b[0m");
 		ASSERT(0);
+		return;
+	}
+	/*set task state so that the scheduler can identify tasks that requested sleep*/
+	tcb->state |= TASK_STATE_SLEEP;
+	/*the wake tick is absolute so it never needs updating, not even when the tick counter rolls over*/
+	if(!OS_timingWheel_insert(sleepWheel,&tcb->sleepNode,wake_tick)){
+		__wakeTask(tcb);// wake tick already reached
+		return;
+	}
+#if SCHEDULER_EAGER_READY_SET
+	/*the task can not run until the sleepWheel wakes it, unlink it from the ready queue straight away*/
+	OS_readyQueue_remove(__readyQueueOf(tcb),tcb);
+#else
+	/*task is not removed from the ready queue, this is done inside the scheduler callback should the scheduler try to run
+	a task that is in the sleep state.*/
+#endif
+}
+
+/* Used by the OS for tickless idle: reports how many ticks remain until the sleepWheel has to wake the next task.
+The sleepWheel has already been advanced to the current tick by the scheduler function, so no task is overdue.
+
+A group that has ready tasks but used up its cap counts as a wakeup at the start of its next period, since its tasks become runnable then.
+
+RETURNS: number of ticks until the next wakeup (never too late, might be early), UINT32_MAX if no task is sleeping*/
+static uint32_t stochasticScheduler_ticksUntilNextWakeup(void){
+	uint32_t ticks = OS_timingWheel_ticksUntilNextEvent(sleepWheel);
+	for(OS_taskGroup_t * group = groupsLinkedList; group; group = group->next){
+		if(group->readyQueue->numTasks && !__groupHasBudget(group)){
+			uint32_t ticksUntilReplenish = group->budgetPeriod - (OS_elapsedTicks() - group->budgetPeriodStart);
+			if(ticksUntilReplenish < ticks){
+				ticks = ticksUntilReplenish;
+			}
+		}
 	}
-	return;
+	if(backgroundGroup->readyQueue->numTasks && !__groupHasBudget(backgroundGroup)){
+		uint32_t ticksUntilReplenish = backgroundGroup->budgetPeriod - (OS_elapsedTicks() - backgroundGroup->budgetPeriodStart);
+		if(ticksUntilReplenish < ticks){
+			ticks = ticksUntilReplenish;
+		}
+	}
+	return ticks;
 }
 
 //=============================================================================
@@ -438,131 +471,103 @@ static void stochasticScheduler_sleepCallback(OS_TCB_t * const tcb,uint32_t min_
 
 /*changes the tasks priority depending on the priority of other tasks that are waiting on resources acquired by this
  * task. The task will use the highest priority (lowest value, minHeap) as its own priority as long as it holds the
- * resource*/
-static void __updatePriorityInheritance(OS_TCB_t * task){
-    OS_mutex_t * acquiredMutex = task->acquiredResourcesLinkedList;
-    uint32_t highestPriority = task->priority;
-    /*loop through all mutexes owned by the given task and determine the highest priority that the task should inherit*/
-    while (acquiredMutex){
-        uint32_t instanceCounter = 0;
-        OS_TCB_t * taskWaitingOnMutex = (OS_TCB_t *)OS_hashtable_getNthValueAtKey(waitingTasksHashTable_reasonAsKey,(uint32_t)acquiredMutex,instanceCounter);
-        /*loop through all tasks waiting on this mutex and determine what the highest priority of the waiting tasks is*/
-        while(waitingTasksHashTable_reasonAsKey->validValueFlag){
-            //REMEMBER, minheap so larger value means less priority
-            uint32_t waitingTaskMaxPriority = (taskWaitingOnMutex->inheritedPriority)? taskWaitingOnMutex->inheritedPriority:taskWaitingOnMutex->priority;
-            if(waitingTaskMaxPriority < highestPriority){
-                highestPriority = waitingTaskMaxPriority;
-            }
-            instanceCounter++;
-            taskWaitingOnMutex = (OS_TCB_t *)OS_hashtable_getNthValueAtKey(waitingTasksHashTable_reasonAsKey,(uint32_t)acquiredMutex,instanceCounter);
-        }
-        acquiredMutex = acquiredMutex->nextAcquiredResource;
+ * resource. Every mutex caches the highest priority of its waiters (maxWaiterPriority), so this only needs to look at
+ * the mutexes the task holds, not at the tasks waiting on them.
+ *
+ * RETURNS: 1 if the effective priority of the task changed, 0 otherwise*/
+static uint32_t __updatePriorityInheritance(OS_TCB_t * task){
+    return __updatePriorityInheritanceFrom(task,__effectivePriority(task));
+}
+
+/*same as __updatePriorityInheritance, but the effective priority is compared against prevEffectivePriority. Needed when the base
+ * priority of the task was changed before the call (see stochasticScheduler_setPriority).*/
+static uint32_t __updatePriorityInheritanceFrom(OS_TCB_t * task, uint32_t prevEffectivePriority){
+    OS_mutex_updateInheritedPriority(task);
+    /*move the task to the list of its new level in the ready queue (if it is part of the ready queue at this point in time)*/
+    if(prevEffectivePriority == __effectivePriority(task)){
+        return 0;
     }
-    /*having determined the priority to inherit set it and move the task to the correct index in the heap (if it is part
-     * of the scheduler heap at this point in time)*/
-    uint32_t isActiveAndInHeap = OS_hashtable_get(tasksInSchedulerHeapHashTable,(uint32_t)task) && tasksInSchedulerHeapHashTable->validValueFlag;
-    if(highestPriority < task->priority ){
-        task->prevInheritedPriority = task->inheritedPriority;
-        task->inheritedPriority = highestPriority;
-    }else{
-        if(task->inheritedPriority && isActiveAndInHeap){//if true it means that the task was running under inherited priority previously
-            /*remove and re-add task to reset priority*/
-            uint32_t taskHeapIndex = OS_heap_indexOfContent(schedulerHeap,(uint32_t)task);
-            void * removedTask;
-            OS_heap_removeNodeAt(schedulerHeap,taskHeapIndex,&removedTask);
-            if(removedTask != task){
-                printf("SCHEDULER: ERROR during priority inheritance reset, taskHeapIndex is incorrect!");
-                ASSERT(0);
-            }
-            OS_heap_addNode(schedulerHeap,task,task->priority);
-        }
-        task->inheritedPriority = 0;//nothing inherited
-        task->prevInheritedPriority = 0;
+    /*remove and re-add the task to the ready queue with the new effective priority*/
+    if(OS_readyQueue_contains(task)){
+        OS_readyQueue_remove(__readyQueueOf(task),task);
+        OS_readyQueue_add(__readyQueueOf(task),task,__effectivePriority(task));
     }
-    /*remove and re-add the task to the heap with the inherited priority*/
-    if(isActiveAndInHeap && task->inheritedPriority && task->prevInheritedPriority != task->inheritedPriority){
-        uint32_t taskHeapIndex = OS_heap_indexOfContent(schedulerHeap,(uint32_t)task);
-        void * removedTask;
-        OS_heap_removeNodeAt(schedulerHeap,taskHeapIndex,&removedTask);
-        if(removedTask != task){
-            printf("SCHEDULER: ERROR during priority inheritance, taskHeapIndex is incorrect!");
-            ASSERT(0);
-        }
-        OS_heap_addNode(schedulerHeap,task,task->inheritedPriority);
+    /*a waiting task has to move within the wait list it is queued in as well*/
+    if(task->waitReason){
+        OS_waitList_reposition((OS_waitList_t *)task->waitReason,task);
     }
+    return 1;
+}
+
+/*changes the base priority of a task at run time. The task is moved to the level of its new effective priority in the ready queue and
+ * within the wait list it is queued in (both O(1) and O(number of waiters) respectively, nothing is removed and re-created). A priority
+ * the task inherited stays in effect while it is higher than the new base priority, and the new priority is passed on to the owner
+ * of a mutex the task is waiting on.
+ *
+ * RETURNS: 1 on success, 0 if the task is not scheduled (never added or already exited) or the priority is 0*/
+static uint32_t stochasticScheduler_setPriority(OS_TCB_t * const tcb, uint32_t task_priority){
+    if(tcb == NULL || !(tcb->state & TASK_STATE_SCHEDULED) || (tcb->state & TASK_STATE_EXIT)){
+        printf("\r\nSCHEDULER: ERROR, cannot change the priority of task %p, it is not scheduled!\r\n",tcb);
+        return 0;
+    }else if(task_priority == 0){
+        printf("\r\nSCHEDULER: ERROR, tried to set priority 0, lowest allowed priority is 1!\r\n");
+        return 0;
+    }
+    uint32_t prevEffectivePriority = __effectivePriority(tcb);
+    tcb->priority = task_priority;
+    if(!__updatePriorityInheritanceFrom(tcb,prevEffectivePriority)){
+        return 1;// effective priority unchanged (e.g. an inherited priority still dominates)
+    }
+    if(tcb->waitingOnMutex){
+        OS_mutex_refreshWaiterPriority((OS_mutex_t *)tcb->waitingOnMutex,__updatePriorityInheritance);
+    }
+    if(!(tcb->state & (TASK_STATE_WAIT | TASK_STATE_SLEEP | TASK_STATE_THROTTLED | TASK_STATE_SUSPENDED))){
+        __preemptIfOutranks(tcb);
+    }
+    return 1;
 }
 
 static void resourceAcquired_callback( OS_mutex_t * _acquiredMutex){
     OS_TCB_t * currentTcb = OS_currentTCB();
     /*Note: for now priority inheritance only works for mutex but can be extended in the future to work for
      * semaphores too. */
-    if(_acquiredMutex->counter != 0 || currentTcb == NULL){
-        /*This resource already seems to have been acquired before by this task and therefore should
-         * not be added again to the acquired resources linked list*/
+    if(!OS_mutex_registerAcquired(currentTcb,_acquiredMutex)){
         return;
     }
-    /*add the resource to the linked list of acquired resources for later use during priority inheritance*/
-	if(_acquiredMutex == currentTcb->acquiredResourcesLinkedList){
-		return;
-	}
-    _acquiredMutex->nextAcquiredResource = NULL;
-    OS_mutex_t * tmpMutex = currentTcb->acquiredResourcesLinkedList;
-    currentTcb->acquiredResourcesLinkedList = _acquiredMutex;
-    _acquiredMutex->nextAcquiredResource = tmpMutex;
+    /*a mutex that was handed over (see stochasticScheduler_notifyOneCallback) might still have waiters to inherit from*/
+    if(_acquiredMutex->maxWaiterPriority){
+        __updatePriorityInheritance(currentTcb);
+    }
 }
 
 //=============================================================================
 // Internal utility functions
 //=============================================================================
-/* Used for picking which task to give cpu time. returns 3 possible values:
-0: pick the task at the current index in heap (40% chance)
-1: go to left child of current node in the heap (30% chance)
-2: go to right child of current node (30% chance)
-
-Biased towards picking the current node to favour tasks with higher priority. consider the following
-example illustrating the problem that arises without this bias
-
-																					3
-																				/   \
-																			5       7
-																		 / \     /
-																		13 21   11
-
-->Node with priority 3 has a 1/3 chance of being picked because it has two valid children.
-->Node with priority 7 has a 1/3*2/3 chance of being picked because it has only one valid child, if
-	the scheduler tries to select its right hand child it will go back to the parent node and select
-	it instead. its left hand child has a probability of 1/3*1/3, so higher priority results in better
-	chances of being picked.
-->This breaks down with the Node of priority 5. it has a probability of being picked of 1/3*1/3 because
-	it has 2 valid children and these children have no children of their own, so their chances are also 1/3*1/3.
-	This means that even though the parent has a higher priority it has the same chances of being picked as its
-	children. Hence the need to bias.
+/* Used for picking which task to give cpu time. returns a uniformly distributed 32bit number that the ready queue scales onto the
+summed weight of the ready tasks (see OS_readyQueue_sampleLevel). The chance of a task being picked therefore only depends on its own
+weight and the weights of the other ready tasks, not on the shape of a data structure or on which levels happen to be non empty.
 */
-static int __getRandForTaskChoice(void){
-	uint32_t value = rand() % 10;
-	if(value <= 3){
-		return 0;//choose parent
-	}else if(value <= 6){
-		return 1;//choose left child
-	}else{
-		return 2;//choose right child
-	}
+static uint32_t __getRandForTaskChoice(void){
+	return OS_prng_next();
+}
+
+/* returns the priority the task currently runs at (inherited priority if it inherited one, otherwise its priority adjusted by
+__adaptPriority). Wait lists order their waiters by the same value (see waitList.c).*/
+static uint32_t __effectivePriority(OS_TCB_t * task){
+	return TASK_EFFECTIVE_PRIORITY(task);
 }
 
-/* Checks if a given task is currently waiting. If task is waiting it is removed from the 
-heap used by the scheduler (heap property restored in the process).
+/* Checks if a given task is currently waiting. If task is waiting it is removed from the
+ready queue used by the scheduler.
 
-If the task is sleeping it must be added to sleepingTasksHashTable prior to this func
+If the task is waiting it must be queued in a wait list prior to this func
 being called or else the pointer to its tcb will be lost.
 
-returns: 1 if the task at_index was waiting and has been removed, 0 otherwise.
+returns: 1 if the task was waiting and has been removed, 0 otherwise.
 */
-static void * removedWaitingNode;
-static uint32_t __removeIfWaiting(uint32_t _index){
-	OS_TCB_t * task = schedulerHeap->ptrToUnderlyingArray[_index].ptrToNodeContent;
+static uint32_t __removeIfWaiting(OS_TCB_t * task){
 	if(task->state & TASK_STATE_WAIT){
-		OS_heap_removeNodeAt(schedulerHeap,_index,&removedWaitingNode);
-		OS_hashtable_remove(tasksInSchedulerHeapHashTable,(uint32_t)task);
+		OS_readyQueue_remove(__readyQueueOf(task),task);
 		return 1;
 	}else{
 		return 0;
@@ -570,145 +575,442 @@ static uint32_t __removeIfWaiting(uint32_t _index){
 }
 
 /*
-Checks if a task is still running, if remove it from all scheduler hashtables and heaps that keep track of tasks
+Checks if a task is still running, if not remove it from the ready queue and hand its memory back
 
-returns: 1 if the task at_index exited and has therefore been removed, 0 otherwise.
+returns: 1 if the task exited and has therefore been removed, 0 otherwise.
 */
-static void * removedNode;
-static uint32_t __removeIfExit(uint32_t _index){
-	OS_TCB_t * task = schedulerHeap->ptrToUnderlyingArray[_index].ptrToNodeContent;
+static uint32_t __removeIfExit(OS_TCB_t * task){
 	if(task->state & (TASK_STATE_EXIT) && task->state & (TASK_STATE_SLEEP | TASK_STATE_WAIT)){
-		/*cannot remove task since if SLEEP or WAITING states are set it might be in a hashtables other than tasksInSchedulerHeapHashTable
-		and activeTasksHashTable. A waiting task should never be able to terminate before it has been woken (same goes for waiting)
+		/*cannot remove task since if SLEEP or WAITING states are set it is still linked into a wait list or
+		the sleepWheel. A waiting task should never be able to terminate before it has been woken (same goes for waiting)
 		so something must be really wrong.*/
 		printf("\u001b[31m\r\nSCHEDULER: ERROR task %p has state TASK_STATE_EXIT set whilst being asleep or waiting!\r\n",task);
-		DEBUG_hashTableState();
 		DEBUG_heapState();
 		printf("\u001b[0m");
 		ASSERT(0);
 		return 0;
 	}else if(task->state & (TASK_STATE_EXIT)){
-		/*task tcb pointer will only be present in schedulerHeap, tasksInSchedulerHeapHashTable, activeTasksHashTable. Removing
-		it there will cause the task to vanish*/
-		OS_heap_removeNodeAt(schedulerHeap,_index,&removedNode);
-		OS_hashtable_remove(tasksInSchedulerHeapHashTable,(uint32_t)task);
-		OS_hashtable_remove(activeTasksHashTable,(uint32_t)task);
-		/*free resources associated with task if nothing else is currently using the memcluster. If memcluster is in use
-		then free resources at a later point in time. Cannot go ahead unless no other task was using the memcluster when the scheduler
-		interrupt was called, since this operation could interfere severly.*/
-		__disable_irq();
-		if(!OS_isMemclusterInUse()){
-			/* CRITICAL SECTION START
-			-> preventing internal mutexes of the memory cluster using svc callbacks
-			-> disable interrupts whilst svc callbacks of locks are disabled*/
-			memory_cluster_setInternalLockState(0);
-			OS_free((uint32_t*)task->originalSpMemoryPointer);
-			OS_free((uint32_t*)task);
-			memory_cluster_setInternalLockState(1);
-			
-			/* CRITICAL SECTION END*/
-		}else if(comletedTasksLinkedList){
-			OS_TCB_t * tmpTask = comletedTasksLinkedList;
-			comletedTasksLinkedList = task;
-			task->data = (uint32_t)tmpTask;
-		}else{
-			comletedTasksLinkedList = task;
-		}
-		__enable_irq();
+		/*task tcb pointer will only be present in readyQueue. Removing it there will cause the task to vanish, its memory is queued for
+		reclaiming when the scheduler switches away from it*/
+		OS_readyQueue_remove(__readyQueueOf(task),task);
 		return 1;
 	}else{
 		return 0;
 	}
 }
 
-/* updates the state of a waiting task. sets the systick_rollover_detected_FLAG should it detect
-a rollover of the systick counter. 
+/* moves a task whose wake tick has been reached out of the sleeping state: its SLEEP state is cleared and it is
+added back to the readyQueue (should it not already be in there).*/
+static void __wakeTask(OS_TCB_t * task){
+	if(task->state & TASK_STATE_THROTTLED){
+		/*not sleeping, the sleepWheel also holds throttled tasks until their budget is replenished. They remain active.*/
+		task->state &= ~TASK_STATE_THROTTLED;
+		__replenishBudgetIfDue(task);
+	}else{
+		task->state &= ~TASK_STATE_SLEEP;
+	}
+	if(task->state & TASK_STATE_SUSPENDED){
+		return;// stays out of the readyQueue until it is resumed
+	}
+	if(!OS_readyQueue_contains(task)){
+		OS_readyQueue_add(__readyQueueOf(task),task,__effectivePriority(task));
+	}
+	__preemptIfOutranks(task);
+}
 
-RETURNS:
-1 = task is still sleeping
-0 = task is not/no longer sleeping
-*/
-static uint32_t __updateSleepState(OS_TCB_t * task){
-	if(!(task->state & TASK_STATE_SLEEP)){
-		return 0;
+/* adds a task that has just been taken out of its wait list (see OS_waitList_wake) back to the ready queue*/
+static void __makeWaiterReady(OS_TCB_t * task){
+	/*without SCHEDULER_EAGER_READY_SET the task might still be linked into the readyQueue, that is expected behaviour. It simply
+	means that a task requested wait but that it was never removed from the readyQueue because the scheduler did not select it
+	(and therefore did not have a chance to remove it from the ready queue). With SCHEDULER_EAGER_READY_SET it was unlinked when
+	it started to wait.*/
+	if(task->state & TASK_STATE_SUSPENDED){
+		return;// stays out of the readyQueue until it is resumed
 	}
-	/*update the remaining sleep duration*/
-	uint32_t currentTime = OS_elapsedTicks();
-	uint32_t lastSleepStateUpdate = task->data;
-	uint32_t remainingTime = task->data2;
-	/*determine elapsed time*/
-	uint32_t deltaTime = 0;
-	if(lastSleepStateUpdate > currentTime){
-		/*systick timer has rolled over, need to set flag to force scheduler to iterate through
-		all elements in the sleepHeap and adjust the remainingTime and lastSleepStateUpdate timestamps to avoid
-		those tasks from sleeping much MUCH (like up to 2^32 systicks) longer than desired.*/
-		systick_rollover_detected_FLAG = 1;
-		uint32_t delta1 = (UINT32_MAX - lastSleepStateUpdate); /*time between last sleep update to task state and
-		the moment the systick timer rolled over*/
-		deltaTime = currentTime + delta1; // total elapsed time
-	}else{
-		deltaTime = currentTime - lastSleepStateUpdate;
-	}
-	task->data = currentTime;//updating update timestamp
-	/*now determine if the task should wake up*/
-	if(remainingTime <= deltaTime){
-		/*yes update hash tables to reflect its new state*/
-		OS_hashtable_remove(sleepingTasksHashTable,(uint32_t)task);
-		OS_hashtable_put(activeTasksHashTable,(uint32_t)task,(uint32_t*)task,HASHTABLE_REJECT_MULTIPLE_VALUES_PER_KEY);
-		/*add the task back to the schedulerHeap should it not already be in there*/
-		if(OS_hashtable_put(tasksInSchedulerHeapHashTable,(uint32_t)task,(uint32_t*)task,HASHTABLE_REJECT_MULTIPLE_VALUES_PER_KEY)){
-            if(task->inheritedPriority)
-                OS_heap_addNode(schedulerHeap,task,task->inheritedPriority);
-            else{
-                OS_heap_addNode(schedulerHeap,task,task->priority);
-            }
+	if(!OS_readyQueue_contains(task)){
+		OS_readyQueue_add(__readyQueueOf(task),task,__effectivePriority(task));
+	}
+	__preemptIfOutranks(task);
+}
+
+/* called whenever a task becomes runnable. If the task outranks the running task (or the cpu is idle) a context switch is pended
+straight away, so the task runs within microseconds rather than after the next SysTick or when the running task yields. If several
+tasks are woken before the switch happens the highest priority one is run first. Any foreground task outranks any background task,
+a task of another group outranks the running task whilst its group is under its share (see __isGroupUnderShare).*/
+static void __preemptIfOutranks(OS_TCB_t * task){
+#if SCHEDULER_PREEMPT_ON_WAKE
+	OS_TCB_t * currentTCB = OS_currentTCB();
+	if(task == currentTCB){
+		return;
+	}
+	if(!__groupHasBudget((OS_taskGroup_t *)task->taskGroup)){
+		return;
+	}
+	uint32_t priority = __effectivePriority(task);
+	uint32_t isBackground = task->taskGroup == backgroundGroup;
+	uint32_t isCurrentBackground = currentTCB != OS_idleTCB_p && currentTCB->taskGroup == backgroundGroup;
+	if(currentTCB != OS_idleTCB_p && !(isCurrentBackground && !isBackground)){
+		/*within a group the priority decides, between groups the cpu is split according to the shares and caps of the groups, so a task
+		of another group only preempts whilst its group is behind its share*/
+		if(task->taskGroup != currentTCB->taskGroup){
+			if(isBackground || !__isGroupUnderShare((OS_taskGroup_t *)task->taskGroup)){
+				return;
+			}
+		}else if(priority >= __effectivePriority(currentTCB)){
+			return;
+		}
+	}
+	if(preemptingTask){
+		uint32_t isPreemptingBackground = preemptingTask->taskGroup == backgroundGroup;
+		if(isBackground && !isPreemptingBackground){
+			return;
+		}
+		if(isBackground == isPreemptingBackground && priority >= __effectivePriority(preemptingTask)){
+			return;
 		}
-		/*finally update the TCB*/
-		task->state &= ~TASK_STATE_SLEEP;
-		task->data2 = 0;
-		return 0;
-	}else{
-		/*nope, update state*/
-		task->data2 -= deltaTime;
-		return 1;
 	}
+	preemptingTask = task;
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+#endif
 }
 
-/* checks if a task at _index in the heap is sleeping and remove it from the heap if
-this is the case (heap property restored in the process). The task is then added to the
-sleepHeap.
+/* The task has just released a resource. If it is currently running under inherited priority this priority needs
+ * to be updated now to reflect this change. The released resource is removed from the tasks linked list of acquired mutexes,
+ * (if the resource cannot be found in that list then do nothing, priority inheritance currently only works for mutex)*/
+static void __releaseAcquiredResource(OS_TCB_t * task, void * resource){
+	if(OS_mutex_unregisterAcquired(task,resource)){
+		__updatePriorityInheritance(task);
+	}
+}
 
-If the task is sleeping it must be added to sleepingTasksHashTable prior to this func
-being called or else the pointer to its tcb will be lost.
+/* checks if a task is sleeping and remove it from the ready queue if
+this is the case. The task stays in the sleepWheel which wakes it up once its wake tick has been reached.
 
 RETURNS:
-1 = task was sleeping and has been removed from heap and tasksInSchedulerHeapHashTable
+1 = task was sleeping and has been removed from the ready queue
 0 = task is awake, no change made
 */
-static void * removedSleepingNode;
-static uint32_t __removeIfSleeping(uint32_t _index){
-	OS_TCB_t * task = schedulerHeap->ptrToUnderlyingArray[_index].ptrToNodeContent;
-	if(__updateSleepState(task)){
-		OS_heap_removeNodeAt(schedulerHeap,_index,&removedSleepingNode);
-		OS_hashtable_remove(tasksInSchedulerHeapHashTable,(uint32_t)task);
-		OS_heap_addNode(sleepHeap,task,task->data2);/*data2 keeps track of remaining sleep duration which
-			the sleepHeap uses to order its elements. This means that tasks that are about to wake up are
-			right at the top of the heap.*/
+static uint32_t __removeIfSleeping(OS_TCB_t * task){
+	if(task->state & TASK_STATE_SLEEP){
+		OS_readyQueue_remove(__readyQueueOf(task),task);
 		return 1;
 	}else{
 		return 0;
 	}
 }
 
+/* RETURNS: the ticks the task may run for before the scheduler picks again (MAX_TASK_TIME_IN_SYSTICKS unless the task set its own)*/
+static uint32_t __quantumOf(OS_TCB_t * task){
+	return task->quantum ? task->quantum : MAX_TASK_TIME_IN_SYSTICKS;
+}
+
+/* RETURNS: 1 if the task may keep running, i.e. it has not used up its quantum and it has not used up its cpu budget for the current
+period, 0 otherwise*/
+static uint32_t __hasRemainingExecutionTime(OS_TCB_t * task, uint32_t ticksRun){
+	if(ticksRun >= __quantumOf(task)){
+		return 0;
+	}
+	OS_taskGroup_t * group = (OS_taskGroup_t *)task->taskGroup;
+	if(group->budget && group->budgetUsed + ticksRun >= group->budget){
+		__groupHasBudget(group);// the period of the group might have ended in the meantime
+		if(group->budgetUsed + ticksRun >= group->budget){
+			return 0;
+		}
+	}
+	if(task->budget){
+		__replenishBudgetIfDue(task);
+		if(task->budgetUsed + ticksRun >= task->budget){
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* feedback for SCHEDULER_ADAPTIVE_PRIORITY, called when the task is switched out. A task that blocked before its quantum was used up
+(e.g. waiting for I/O) is boosted by one level, a task that ran for its whole quantum is demoted by one level, a task that yielded or was
+preempted keeps its level. The bias stays within STOCHASTIC_ADAPTIVE_MAX_BOOST/STOCHASTIC_ADAPTIVE_MAX_DEMOTION, so a task can never
+drift far from the priority it was given. A changed bias is handled like OS_setPriority(): the task moves to its new level in the ready
+queue and, if it just started waiting, to its new place in the wait list, and the priority its mutex passes on is refreshed.*/
+static void __adaptPriority(OS_TCB_t * task, uint32_t ticksRun){
+#if SCHEDULER_ADAPTIVE_PRIORITY
+	uint32_t prevEffectivePriority = __effectivePriority(task);
+	if(ticksRun < __quantumOf(task)){
+		if((task->state & (TASK_STATE_WAIT | TASK_STATE_SLEEP)) && task->priorityBias > -STOCHASTIC_ADAPTIVE_MAX_BOOST){
+			task->priorityBias--;
+		}
+	}else if(task->priorityBias < STOCHASTIC_ADAPTIVE_MAX_DEMOTION){
+		task->priorityBias++;
+	}
+	if(__updatePriorityInheritanceFrom(task,prevEffectivePriority) && task->waitingOnMutex){
+		OS_mutex_refreshWaiterPriority((OS_mutex_t *)task->waitingOnMutex,__updatePriorityInheritance);
+	}
+#endif
+}
+
+/* starts a new budget period (with the full budget) if the current period of the task has ended. Periods stay aligned to the tick the
+budget was set at, a task that did not run for several periods simply skips them.*/
+static void __replenishBudgetIfDue(OS_TCB_t * task){
+	uint32_t sincePeriodStart = OS_elapsedTicks() - task->budgetPeriodStart;
+	if(sincePeriodStart >= task->budgetPeriod){
+		task->budgetPeriodStart += sincePeriodStart - (sincePeriodStart % task->budgetPeriod);
+		task->budgetUsed = 0;
+	}
+}
+
+/* adds the ticks the task ran for to the budget it used in the current period. A task that is still runnable but has used up its budget is
+throttled: it is removed from the ready queue and put into the sleepWheel until its next period starts (see __wakeTask).
+
+Only whole ticks are measured, so every dispatch is charged at least one tick (as in the stride scheduler). Otherwise a task that is
+woken at a tick boundary and blocks before the next SysTick would run for free, no matter how often it does so.*/
+static void __chargeTask(OS_TCB_t * task, uint32_t ticksRun){
+	if(ticksRun == 0){
+		ticksRun = 1;
+	}
+	__chargeGroup((OS_taskGroup_t *)task->taskGroup,ticksRun);
+	if(task->budget == 0){
+		return;
+	}
+	__replenishBudgetIfDue(task);
+	task->budgetUsed += ticksRun;
+	if(task->budgetUsed < task->budget || (task->state & (TASK_STATE_WAIT | TASK_STATE_SLEEP | TASK_STATE_SUSPENDED))){
+		return;// a blocked task is caught when it runs again
+	}
+	task->state |= TASK_STATE_THROTTLED;
+	OS_readyQueue_remove(__readyQueueOf(task),task);
+	if(!OS_timingWheel_insert(sleepWheel,&task->sleepNode,task->budgetPeriodStart + task->budgetPeriod)){
+		__wakeTask(task);// next period has already started
+	}
+}
+
+//=============================================================================
+// Task groups
+//=============================================================================
+
+/* returns the ready queue of the group the task belongs to*/
+static OS_readyQueue_t * __readyQueueOf(OS_TCB_t * task){
+	return ((OS_taskGroup_t *)task->taskGroup)->readyQueue;
+}
+
+/* picks one of the groups that have ready tasks and cpu budget left, with a chance of its share divided by the summed share of these
+groups. Takes time proportional to the number of groups (not tasks), which is expected to be small.
+
+RETURNS: the picked group, NULL if no group can run*/
+static OS_taskGroup_t * __sampleGroup(uint32_t random){
+	uint32_t totalShare = 0;
+	OS_taskGroup_t * onlyCandidate = NULL;
+	for(OS_taskGroup_t * group = groupsLinkedList; group; group = group->next){
+		if(group->readyQueue->priorityBitmap && __groupHasBudget(group)){
+			totalShare += group->share;
+			onlyCandidate = group;
+		}
+	}
+	if(totalShare == 0){
+		return onlyCandidate;// either no candidate or only candidates with a share of 0
+	}
+	uint32_t target = (uint32_t)(((uint64_t)random * totalShare) >> 32);
+	for(OS_taskGroup_t * group = groupsLinkedList; group; group = group->next){
+		if(group->readyQueue->priorityBitmap && __groupHasBudget(group)){
+			if(target < group->share){
+				return group;
+			}
+			target -= group->share;
+		}
+	}
+	return onlyCandidate;
+}
+
+/* RETURNS: 1 if a task of a group other than the background band can run, i.e. a group has ready tasks and cpu budget left, 0 otherwise*/
+static uint32_t __isForegroundReady(void){
+	for(OS_taskGroup_t * group = groupsLinkedList; group; group = group->next){
+		if(group->readyQueue->priorityBitmap && __groupHasBudget(group)){
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* selection policy of the background band: the highest priority ready background task is run, tasks that share the highest level
+take turns (round robin). There is no randomness, maintenance work of a lower priority simply waits for the work above it.
+
+RETURNS: the background task to run, NULL if none can run*/
+static OS_TCB_t * __selectBackgroundTask(void){
+	OS_readyQueue_t * queue = backgroundGroup->readyQueue;
+	if(!__groupHasBudget(backgroundGroup)){
+		return NULL;
+	}
+	while(queue->priorityBitmap){
+		OS_TCB_t * task = OS_readyQueue_rotateLevel(queue,OS_readyQueue_highestLevel(queue));
+		if(__removeIfExit(task) || __removeIfWaiting(task) || __removeIfSleeping(task)){
+			continue;
+		}
+		return task;
+	}
+	return NULL;
+}
+
+/* starts a new period of the group if its current one has ended.
+
+RETURNS: 1 if the group is uncapped or has budget left in its current period, 0 otherwise*/
+static uint32_t __groupHasBudget(OS_taskGroup_t * group){
+	if(group->budget == 0){
+		return 1;
+	}
+	uint32_t sincePeriodStart = OS_elapsedTicks() - group->budgetPeriodStart;
+	if(sincePeriodStart >= group->budgetPeriod){
+		group->budgetPeriodStart += sincePeriodStart - (sincePeriodStart % group->budgetPeriod);
+		group->budgetUsed = 0;
+	}
+	return group->budgetUsed < group->budget;
+}
+
+/* adds the ticks a task of the group ran for to the recent usage of the group and to the budget the group used in the current period.
+Once STOCHASTIC_GROUP_USAGE_WINDOW ticks were used the recent usage of every group is halved, so old usage fades out. Takes time
+proportional to the number of groups whenever this happens.*/
+static void __chargeGroup(OS_taskGroup_t * group, uint32_t ticksRun){
+	if(group != backgroundGroup){
+		group->recentUsage += ticksRun;
+		groupsRecentUsage += ticksRun;
+		if(groupsRecentUsage >= STOCHASTIC_GROUP_USAGE_WINDOW){
+			groupsRecentUsage = 0;
+			for(OS_taskGroup_t * other = groupsLinkedList; other; other = other->next){
+				other->recentUsage >>= 1;
+				groupsRecentUsage += other->recentUsage;
+			}
+		}
+	}
+	if(group->budget == 0){
+		return;
+	}
+	__groupHasBudget(group);
+	group->budgetUsed += ticksRun;
+}
+
+/* compares the recent usage of the group with its share of the groups that can run (the group itself included).
+
+RETURNS: 1 if the group used less than its share of the cpu recently, 0 otherwise*/
+static uint32_t __isGroupUnderShare(OS_taskGroup_t * group){
+	uint32_t totalShare = group->share;
+	for(OS_taskGroup_t * other = groupsLinkedList; other; other = other->next){
+		if(other != group && other->readyQueue->priorityBitmap && __groupHasBudget(other)){
+			totalShare += other->share;
+		}
+	}
+	if(groupsRecentUsage == 0){
+		return group->share != 0;
+	}
+	return (uint64_t)group->recentUsage * totalShare < (uint64_t)group->share * groupsRecentUsage;
+}
+
+/* creates a task group. Once picked by the scheduler the group receives _share divided by the summed share of all groups that have
+ready tasks, so an idle group leaves its time to the others. Tasks join a group with OS_setTaskGroup().
+
+NOTE: a task that holds a mutex runs at the share of its own group even whilst it passes on an inherited priority, so a task in a
+group with a small share or cap can delay a waiter of another group.
+
+RETURNS: the new group, NULL if it could not be allocated*/
+OS_taskGroup_t * OS_stochastic_newTaskGroup(uint32_t _share){
+	OS_taskGroup_t * group = __newGroup(_share);
+	if(group == NULL){
+		return NULL;
+	}
+	__disable_irq();// the scheduler walks the list of groups
+	group->next = groupsLinkedList;
+	groupsLinkedList = group;
+	__enable_irq();
+	return group;
+}
+
+/* allocates and initialises a group without linking it into groupsLinkedList.
+
+RETURNS: the new group, NULL if it could not be allocated*/
+static OS_taskGroup_t * __newGroup(uint32_t share){
+	OS_taskGroup_t * group = (OS_taskGroup_t *)OS_alloc(sizeof(OS_taskGroup_t)/4);
+	if(group == NULL){
+		printf("\u001b[31m\r\nSCHEDULER: ERROR cannot allocate memory for task group!\r\n\u001b[0m");
+		ASSERT(0);
+		return NULL;
+	}
+	group->readyQueue = new_readyQueue();
+	if(group->readyQueue == NULL){
+		OS_free((uint32_t *)group);
+		return NULL;
+	}
+	OS_readyQueue_setLevelWeights(group->readyQueue,weightOfPriority);
+	group->share = share;
+	group->budget = group->budgetPeriod = group->budgetUsed = 0;
+	group->budgetPeriodStart = OS_elapsedTicks();
+	group->recentUsage = 0;
+	group->next = NULL;
+	return group;
+}
+
+/* caps the group to _budgetTicks of cpu time in every period of _periodTicks, shared by all of its tasks. Once the cap is reached none
+of the tasks of the group is run until the next period starts, no matter how large the share of the group is. A budget of 0 removes
+the cap.*/
+void OS_stochastic_setGroupCap(OS_taskGroup_t * _group, uint32_t _budgetTicks, uint32_t _periodTicks){
+	if(_budgetTicks && _periodTicks < _budgetTicks){
+		_periodTicks = _budgetTicks;// a budget larger than its period would never be exhausted
+	}
+	__disable_irq();
+	_group->budget = _budgetTicks;
+	_group->budgetPeriod = _periodTicks;
+	_group->budgetUsed = 0;
+	_group->budgetPeriodStart = OS_elapsedTicks();
+	__enable_irq();
+}
+
+/* RETURNS: the group of every task that was not put into a group explicitly*/
+OS_taskGroup_t * OS_stochastic_defaultTaskGroup(void){
+	return defaultGroup;
+}
+
+/* RETURNS: the background band. Tasks put into it with OS_setTaskGroup() only run whilst no other task can run, see backgroundGroup.
+The band has no share, it can be capped with OS_stochastic_setGroupCap() like any other group.
+
+NOTE: a background task that holds a mutex a foreground task waits for still only runs when the cpu is otherwise idle, so background
+tasks should not share mutexes with time critical tasks.*/
+OS_taskGroup_t * OS_stochastic_backgroundTaskGroup(void){
+	return backgroundGroup;
+}
+
+//=============================================================================
+// Selection weights
+//=============================================================================
+
+/* default weight function: a task is twice as likely to be picked as a task one priority below it. Priorities from
+STOCHASTIC_WEIGHT_FLOOR_PRIORITY downwards all have a weight of 1, which keeps the summed weight of up to 2^16 ready tasks within 32 bits*/
+uint32_t OS_stochastic_defaultWeight(uint32_t _priority){
+	if(_priority >= STOCHASTIC_WEIGHT_FLOOR_PRIORITY){
+		return 1;
+	}
+	return 1UL << (STOCHASTIC_WEIGHT_FLOOR_PRIORITY - _priority);
+}
+
+/* changes how the chance of a task being picked depends on its priority, e.g. a linear function gives low priority tasks a much larger
+share than the default. _weightOfPriority is called once per priority level here and never on a task switch. A weight of 0 means tasks
+of that priority only run when no task with a non zero weight is ready.
+
+NOTE: (largest weight) * (number of ready tasks) must be less than 2^32*/
+void OS_stochastic_setWeightFunction(uint32_t (* _weightOfPriority)(uint32_t _priority)){
+	__disable_irq();// the scheduler must not sample the ready queue whilst its weights are rebuilt
+	weightOfPriority = _weightOfPriority;
+	for(OS_taskGroup_t * group = groupsLinkedList; group; group = group->next){
+		OS_readyQueue_setLevelWeights(group->readyQueue,_weightOfPriority);
+	}
+	__enable_irq();
+}
+
 //=============================================================================
 // Externally accessible utility functions
 //=============================================================================
-/* Following functions can be used to check various states of a specific task by checking the internal hashtables of the scheduler.
+/* Following functions can be used to check various states of a specific task. The state is read straight from the TCB, so these
+ * take the same time no matter how many tasks there are. A task that is throttled (see OS_setTaskBudget) counts as active, a task that
+ * is suspended (see OS_suspend) does not.
  *
  * RETURNS: 1 if true, 0 otherwise*/
 
 uint32_t OS_scheduler_isTaskActive(OS_TCB_t * _task){
-	if(OS_hashtable_get(activeTasksHashTable,(uint32_t)_task)){
+	if((_task->state & TASK_STATE_SCHEDULED) && !(_task->state & (TASK_STATE_WAIT | TASK_STATE_SLEEP | TASK_STATE_EXIT | TASK_STATE_SUSPENDED))){
 		return 1;
 	}else{
 		return 0;
@@ -716,7 +1018,7 @@ uint32_t OS_scheduler_isTaskActive(OS_TCB_t * _task){
 }
 
 uint32_t OS_scheduler_isTaskSleeping(OS_TCB_t * _task){
-	if(OS_hashtable_get(sleepingTasksHashTable,(uint32_t)_task)){
+	if((_task->state & TASK_STATE_SCHEDULED) && (_task->state & TASK_STATE_SLEEP)){
 		return 1;
 	}else{
 		return 0;
@@ -724,7 +1026,15 @@ uint32_t OS_scheduler_isTaskSleeping(OS_TCB_t * _task){
 }
 
 uint32_t OS_scheduler_isTaskWaiting(OS_TCB_t * _task){
-	if(OS_hashtable_get(waitingTasksHashTable_tcbAsKey,(uint32_t)_task)){
+	if((_task->state & TASK_STATE_SCHEDULED) && (_task->state & TASK_STATE_WAIT)){
+		return 1;
+	}else{
+		return 0;
+	}
+}
+
+uint32_t OS_scheduler_isTaskSuspended(OS_TCB_t * _task){
+	if((_task->state & TASK_STATE_SCHEDULED) && (_task->state & TASK_STATE_SUSPENDED)){
 		return 1;
 	}else{
 		return 0;
@@ -732,7 +1042,7 @@ uint32_t OS_scheduler_isTaskWaiting(OS_TCB_t * _task){
 }
 
 uint32_t OS_scheduler_doesTaskExist(OS_TCB_t * _task){
-	if(OS_scheduler_isTaskActive(_task) || OS_scheduler_isTaskSleeping(_task) || OS_scheduler_isTaskWaiting(_task)){
+	if(OS_scheduler_isTaskActive(_task) || OS_scheduler_isTaskSleeping(_task) || OS_scheduler_isTaskWaiting(_task) || OS_scheduler_isTaskSuspended(_task)){
 		return 1;
 	}else{
 		return 0;
@@ -743,26 +1053,15 @@ uint32_t OS_scheduler_doesTaskExist(OS_TCB_t * _task){
 // DEBUG functions
 //=============================================================================
 
-static void DEBUG_hashTableState(){
-	printf("\r\n\r\n######################################################################\r\n");
-	printf("DEBUG: DUMPING CONTENT OF SCHEDULER HASH TABLES!\r\n");
-	printf("\r\nACTIVE TASK HASH TABLE:");
-	DEBUG_printHashtable(activeTasksHashTable);
-	printf("\r\nTASKS IN SCHEDULER HEAP HASH TABLE:");
-	DEBUG_printHashtable(tasksInSchedulerHeapHashTable);
-	printf("\r\nWAITING TASK HASH TABLE:\r\nNOTE: the key is the reason the task is waiting, multiple entries with same key are allowed provided their 'data' fields differ.\r\n");
-	DEBUG_printHashtable(waitingTasksHashTable_reasonAsKey);
-	printf("\r\nSLEEPING TASK HASH TABLE:");
-	DEBUG_printHashtable(sleepingTasksHashTable);
-    printf("\r\nNODE CONTENT INDEX:");
-    DEBUG_printHashtable(schedulerHeap->nodeContentIndexHashTable);
-}
-
 static void DEBUG_heapState(){
 	printf("\r\n\r\n######################################################################\r\n");
 	printf("DEBUG: DUMPING CONTENT OF HEAPS!\r\n");
-	printf("\r\nTASK HEAP:\r\n");
-	printHeap(schedulerHeap);
-	printf("\r\nSLEEP HEAP:\r\n");
-	printHeap(sleepHeap);
+	for(OS_taskGroup_t * group = groupsLinkedList; group; group = group->next){
+		printf("\r\nREADY QUEUE OF GROUP %p (share %d, budget %d/%d used):\r\n",group,group->share,group->budgetUsed,group->budget);
+		DEBUG_printReadyQueue(group->readyQueue);
+	}
+	printf("\r\nREADY QUEUE OF BACKGROUND GROUP %p (budget %d/%d used):\r\n",backgroundGroup,backgroundGroup->budgetUsed,backgroundGroup->budget);
+	DEBUG_printReadyQueue(backgroundGroup->readyQueue);
+	printf("\r\nSLEEP WHEEL:\r\n");
+	DEBUG_printTimingWheel(sleepWheel);
 }
@@ -5,28 +5,71 @@
 #include "stm32f4xx.h"
 #include "structs.h"
 #include "../DataStructures/heap.h"
+#include "../DataStructures/readyQueue.h"
+#include "../DataStructures/timingWheel.h"
+#include "../DataStructures/waitList.h"
 #include "../DataStructures/mutex.h"
 #include <stdlib.h>
-#include "../DataStructures/hashtable.h"
 #include "memcluster.h"
+#include "prng.h"
 #include "os.h"
 
-/*  The maximum number of tasks the scheduler can deal with*/
-#define MAX_TASKS MAX_HEAP_SIZE
-
-/*measured in SysTicks. If any given task has no*/
+/*measured in SysTicks. Time a task may run for before the scheduler picks again, unless the task sets its own quantum
+(see OS_setTaskQuantum)*/
 #define MAX_TASK_TIME_IN_SYSTICKS 100
 
-#define NUM_BUCKETS_FOR_WAIT_HASHTABLE 8
-#define WAIT_HASHTABLE_CAPACITY 32
+/* 1: wait, sleep and task exit unlink the task from the ready queue at the moment they happen, so every task the scheduler samples
+ *    is runnable and selection does a bounded amount of work.
+ * 0: tasks stay in the ready queue and are removed lazily, only if the scheduler happens to sample them.*/
+#define SCHEDULER_EAGER_READY_SET 1
+
+/* 1: a notify or a sleep expiry that makes a task runnable which outranks the running task (or wakes a task whilst the cpu is idle)
+ *    pends a context switch straight away and the woken task is run next, instead of after the running task used up its quantum.
+ *    Within a group a task outranks by priority. A task of another group outranks the running task if its group has budget left and
+ *    has recently used less than its share of the cpu (see STOCHASTIC_GROUP_USAGE_WINDOW), priorities are not compared across groups.
+ * 0: woken tasks are only considered at the next task switch.*/
+#define SCHEDULER_PREEMPT_ON_WAKE 1
+
+/* 1: the priority a task is selected with follows how the task behaves. A task that blocks (waits or sleeps) before using up its quantum
+ *    is boosted by one level, a task that uses up its whole quantum is demoted by one level, within the bounds below around the priority
+ *    it was given. The adjusted priority is used everywhere the priority of the task is (selection, wait lists, priority inheritance).
+ * 0: tasks are always selected with the priority they were given.*/
+#define SCHEDULER_ADAPTIVE_PRIORITY 0
+
+/*levels a task can be boosted above (i.e. lower value) or demoted below its priority with SCHEDULER_ADAPTIVE_PRIORITY*/
+#define STOCHASTIC_ADAPTIVE_MAX_BOOST 2
+#define STOCHASTIC_ADAPTIVE_MAX_DEMOTION 4
+
+/*priority from which on the default selection weight stops halving (see OS_stochastic_defaultWeight)*/
+#define STOCHASTIC_WEIGHT_FLOOR_PRIORITY 17
 
-void initialize_scheduler(uint32_t _sizeOfHeapNodeArray);
+/*share of the default group, i.e. of every task that was not put into a group (see OS_setTaskGroup)*/
+#define STOCHASTIC_DEFAULT_GROUP_SHARE 100
+
+/*ticks of cpu time after which the recent usage of every group is halved. The recent usage decides whether a group is under its share,
+which a woken task needs for preempting a task of another group (see SCHEDULER_PREEMPT_ON_WAKE)*/
+#define STOCHASTIC_GROUP_USAGE_WINDOW 1024
+
+void initialize_scheduler(uint32_t _initialTaskCapacity);
 extern OS_Scheduler_t const stochasticScheduler;
 
+/*selection weights. A ready task is picked with a probability of its weight divided by the summed weight of all ready tasks, the
+weight is a function of the (effective) priority of the task. OS_stochastic_defaultWeight() is used unless a different function is set
+after OS_init()*/
+uint32_t OS_stochastic_defaultWeight(uint32_t _priority);
+void OS_stochastic_setWeightFunction(uint32_t (* _weightOfPriority)(uint32_t _priority));
+
+/*task groups. Call after OS_init()*/
+OS_taskGroup_t * OS_stochastic_newTaskGroup(uint32_t _share);
+void OS_stochastic_setGroupCap(OS_taskGroup_t * _group, uint32_t _budgetTicks, uint32_t _periodTicks);
+OS_taskGroup_t * OS_stochastic_defaultTaskGroup(void);
+OS_taskGroup_t * OS_stochastic_backgroundTaskGroup(void);
+
 /*externally accessible utility functions. This is useful for checking the state of an arbitrary task*/
 uint32_t OS_scheduler_isTaskActive(OS_TCB_t * _task);
 uint32_t OS_scheduler_isTaskSleeping(OS_TCB_t * _task);
 uint32_t OS_scheduler_isTaskWaiting(OS_TCB_t * _task);
+uint32_t OS_scheduler_isTaskSuspended(OS_TCB_t * _task);
 uint32_t OS_scheduler_doesTaskExist(OS_TCB_t * _task);
 
 #endif //DOCETOS_stochasticScheduler_H
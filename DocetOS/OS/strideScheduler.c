@@ -0,0 +1,447 @@
+#include "strideScheduler.h"
+
+//=============================================================================
+// vars
+//=============================================================================
+
+//READY HEAP RELATED
+/*readyHeap
+holds every task that is ready to run, except the one that is currently running, ordered by pass. The task with the lowest pass
+is always the next one to run. Once a task has run its pass is advanced by its stride times the number of ticks it ran for,
+so a task with twice the tickets (half the stride) runs twice as often.*/
+static OS_minHeap_t * readyHeap;
+/*pass of the task that was selected last. This is the "virtual time" of the scheduler, it never decreases and every task in the
+readyHeap has a pass of at least globalPass.*/
+static uint32_t globalPass = 0;
+/*task that was selected last (NULL if the idle task was selected). It is not in the readyHeap while it runs, the scheduler charges it
+and puts it back once it is switched out.*/
+static OS_TCB_t * runningTask = NULL;
+/*tick at which runningTask was selected, used to charge it for the time it actually ran*/
+static uint32_t runningTaskStartTick = 0;
+
+//WAIT RELATED
+/*waiting tasks are queued in the wait list embedded in the object they wait for (see waitList.c). Waiting tasks are never in the readyHeap.*/
+
+//SLEEP RELATED
+/*sleepWheel
+holds every sleeping task keyed by the absolute tick at which it has to wake up. Sleeping tasks are never in the readyHeap.*/
+static OS_timingWheel_t * sleepWheel;
+
+static uint32_t numTasks = 0; /*tasks that have been added and not yet reclaimed, the readyHeap is kept large enough to hold all of them*/
+
+/*NOTE: whilst a task is waiting or sleeping its pass field does not hold a pass but its lag, i.e. how far its pass was ahead of
+globalPass when it stopped being ready. Its pass is rebuilt from the lag once it is ready again, so a task that blocked for a long time
+does not return with a pass far behind everybody else (and then hog the CPU until it caught up), and rebasing never needs to touch it.*/
+
+//=============================================================================
+// prototypes
+//=============================================================================
+
+//svc accessible
+static OS_TCB_t const * strideScheduler_scheduler(void);
+static void strideScheduler_addTask(OS_TCB_t * const tcb,uint32_t task_priority);
+static void strideScheduler_taskExit(OS_TCB_t * const tcb);
+static void strideScheduler_waitCallback(void * const _reason, uint32_t checkCode,uint32_t _isReasonMutex);
+static void strideScheduler_notifyCallback(void * const reason);
+static void strideScheduler_notifyOneCallback(void * const reason, uint32_t _isReasonMutex);
+static void strideScheduler_sleepCallback(OS_TCB_t * const tcb,uint32_t min_sleep_duration);
+static void strideScheduler_resourceAcquired(OS_mutex_t * _acquiredMutex);
+static uint32_t strideScheduler_ticksUntilNextWakeup(void);
+static uint32_t strideScheduler_setPriority(OS_TCB_t * const tcb, uint32_t task_priority);
+
+//internal
+static uint32_t __strideOfPriority(uint32_t priority);
+static uint32_t __effectivePriority(OS_TCB_t * task);
+static void __makeReady(OS_TCB_t * task);
+static void __chargeRunningTask(void);
+static void __rebasePasses(void);
+static void __reclaimTask(OS_TCB_t * task);
+static uint32_t __reserveReadyHeapCapacity(uint32_t _numTasks);
+static void __wakeTask(OS_TCB_t * task);
+static void __releaseAcquiredResource(OS_TCB_t * task, void * resource);
+static uint32_t __updatePriorityInheritance(OS_TCB_t * task);
+static uint32_t __updatePriorityInheritanceFrom(OS_TCB_t * task, uint32_t prevEffectivePriority);
+
+//debug
+static void DEBUG_schedulerState(void);
+
+//=============================================================================
+// init
+//=============================================================================
+
+/*scheduler struct init*/
+OS_Scheduler_t const strideScheduler = {
+		.preemptive = 1,
+		.init_callback = initialize_strideScheduler,
+		.scheduler_callback = strideScheduler_scheduler,
+		.addtask_callback = strideScheduler_addTask,
+		.taskexit_callback = strideScheduler_taskExit,
+		.wait_callback = strideScheduler_waitCallback,
+		.notify_callback = strideScheduler_notifyCallback,
+		.notifyOne_callback = strideScheduler_notifyOneCallback,
+		.sleep_callback = strideScheduler_sleepCallback,
+		.resourceAcquired_callback = strideScheduler_resourceAcquired,
+		.ticksUntilNextWakeup_callback = strideScheduler_ticksUntilNextWakeup,
+		.setPriority_callback = strideScheduler_setPriority
+};
+
+void initialize_strideScheduler(uint32_t _initialTaskCapacity){
+	/*the readyHeap must be able to hold every task (a task that cannot be put back into the heap would be lost). It starts out with room
+	for _initialTaskCapacity tasks and grows whenever a task is added that would not fit (see __reserveReadyHeapCapacity)*/
+	readyHeap = new_heap(_initialTaskCapacity,0);
+	OS_heap_setFifoTies(readyHeap,STRIDE_SCHEDULER_FIFO_TIES);
+	sleepWheel = new_timingWheel(OS_elapsedTicks());
+}
+
+//=============================================================================
+// SCHEDULER FUNCTION
+//=============================================================================
+/* Determines which of the AWAKE and NOT WAITING tasks should be executed. The task with the lowest pass is selected, which gives every
+task a share of the cpu time that is proportional to its tickets. Unlike the stochastic scheduler the shares are deterministic, over any
+window of time each busy task receives its share to within one quantum.
+*/
+static OS_TCB_t const * strideScheduler_scheduler(void){
+	OS_TCB_t * currentTaskTCB = OS_currentTCB();
+
+	/*check if task has yielded, is waiting, sleeping or has exited. If not then force it to yield if it has used up its quantum.
+	Otherwise allow it to continue running.*/
+	if( currentTaskTCB != OS_idleTCB_p ){
+		uint32_t isCurrentTaskDone = currentTaskTCB->state & TASK_STATE_EXIT;
+		uint32_t hasTaskStateChanged = currentTaskTCB->state & (TASK_STATE_YIELD | TASK_STATE_WAIT | TASK_STATE_SLEEP);
+		uint32_t quantum = currentTaskTCB->quantum ? currentTaskTCB->quantum : STRIDE_SCHEDULER_QUANTUM_IN_SYSTICKS;
+		uint32_t hasRemainingExecutionTime = (OS_elapsedTicks() - runningTaskStartTick) < quantum;
+		if(!isCurrentTaskDone && !hasTaskStateChanged && hasRemainingExecutionTime){
+			//task is allowed to continue running
+			return currentTaskTCB;
+		}
+	}
+
+	/*free resources associated with tasks that have run to completion in earlier runs (the task switched away from now is only queued
+	further down, see OS_reclaimTaskLater). These resources might not have been freed yet because the memcluster was in use.*/
+	OS_reclaimCompletedTasks();
+
+	currentTaskTCB->state &= ~TASK_STATE_YIELD;// reset so task has chance of running after next task switch
+
+	/*wake every sleeping task whose wake tick has been reached*/
+	OS_timingWheelNode_t * wokenNode = OS_timingWheel_advance(sleepWheel,OS_elapsedTicks());
+	while(wokenNode){
+		OS_TCB_t * wokenTask = (OS_TCB_t *)wokenNode->ptrToNodeContent;
+		wokenNode = wokenNode->next;
+		__wakeTask(wokenTask);
+	}
+
+	/*the task that just ran pays for the time it used and goes back into the readyHeap if it is still ready
+	(THIS MUST RUN BEFORE SELECTING THE NEXT TASK! DONT MOVE THIS!)*/
+	__chargeRunningTask();
+
+	/*select the task with the lowest pass*/
+	void * selectedTask;
+	if(!OS_heap_removeNode(readyHeap,&selectedTask)){
+		return OS_idleTCB_p;// no ready tasks currently (maybe all sleeping).
+	}
+	runningTask = (OS_TCB_t *)selectedTask;
+	runningTaskStartTick = OS_elapsedTicks();
+	globalPass = runningTask->pass;
+	if(globalPass >= STRIDE_SCHEDULER_REBASE_THRESHOLD){
+		__rebasePasses();
+	}
+	return runningTask;
+}
+
+//=============================================================================
+// Task related function definitions
+//=============================================================================
+
+/* Adds a task to the scheduler. The priority determines the number of tickets the task holds (see STRIDE_SCHEDULER_MAX_TICKETS).
+The task starts with a pass of one stride past globalPass, so it can not jump ahead of the tasks that are already running.
+*/
+static void strideScheduler_addTask(OS_TCB_t * const tcb,uint32_t task_priority){
+	if(tcb == NULL){
+		printf("\r\nSTRIDE SCHEDULER: ERROR, attempt to add null pointer tcb to scheduler!\r\n");
+		ASSERT(0);
+		return;
+	}else if(tcb->state != 0 || tcb->stride != 0){
+		printf("\r\nSTRIDE SCHEDULER: ERROR, cannot add task %p, it has state 0x%08x and might already have been added!\r\n",tcb,tcb->state);
+		ASSERT(0);
+		return;
+	}else if(task_priority == 0){
+		printf("\r\nSTRIDE SCHEDULER: ERROR, tried to add task with priority 0, lowest allowed priority is 1!\r\n");
+		ASSERT(0);
+		return;
+	}
+	if(!__reserveReadyHeapCapacity(numTasks + 1)){
+		printf("\r\nSTRIDE SCHEDULER: unable to add task %p, the readyHeap could not grow beyond %d tasks!\r\n",tcb,readyHeap->maxNumberOfNodes);
+		return;
+	}
+	tcb->priority = task_priority;
+	tcb->stride = __strideOfPriority(task_priority);
+	tcb->pass = tcb->stride;// lag of one stride, see __makeReady
+	numTasks++;
+	__makeReady(tcb);
+}
+
+/* This function is automatically called when a task exits. The task is running and therefore not in the readyHeap, the scheduler
+reclaims it when it switches away from it.
+
+NOTE: this function should NEVER be called manually
+*/
+static void strideScheduler_taskExit(OS_TCB_t * const tcb){
+	tcb->state |= TASK_STATE_EXIT;
+	tcb->data = NULL; // used in completed tasks linked list. Needs to be NULL if not pointing to other completed task
+}
+
+//=============================================================================
+// wait, notify and sleep
+//=============================================================================
+
+/*Marks the current task as waiting and queues it in the wait list of the object it waits for. The task is running and therefore
+not in the readyHeap, the scheduler will not put it back as long as it is waiting.*/
+static void strideScheduler_waitCallback(void * const _reason, uint32_t checkCode,uint32_t _isReasonMutex){
+	if (checkCode != OS_checkCode(_reason)){
+		return;//checkcode mismatch, notify called during function that uses wait
+	}
+	OS_TCB_t * currentTCB = OS_currentTCB();
+	OS_waitList_insert((OS_waitList_t *)_reason,currentTCB,_reason);
+	currentTCB->state |= TASK_STATE_WAIT;
+
+	/*start the priority inheritance*/
+	if(_isReasonMutex){
+		OS_mutex_t * mutex = (OS_mutex_t *)_reason;
+		currentTCB->waitingOnMutex = mutex;
+		OS_mutex_propagateInheritance(mutex,__effectivePriority(currentTCB),__updatePriorityInheritance);
+	}
+}
+
+static void strideScheduler_notifyCallback(void * const reason){
+	/*make all the tasks that are waiting for the given reason ready again*/
+	OS_waitList_t * waiters = (OS_waitList_t *)reason;
+	while(waiters->head){
+		OS_TCB_t * task = waiters->head;
+		if(task->waitingOnMutex == reason){
+			((OS_mutex_t *)reason)->maxWaiterPriority = 0;// every waiter is woken
+		}
+		OS_waitList_wake(waiters,task);
+		__makeReady(task);
+	}
+	__releaseAcquiredResource(OS_currentTCB(),reason);
+}
+
+/*wakes only the highest priority waiter and hands a released mutex to it directly (see OS_mutex_handOff)*/
+static void strideScheduler_notifyOneCallback(void * const reason, uint32_t _isReasonMutex){
+	OS_TCB_t * task;
+	if(_isReasonMutex){
+		task = OS_mutex_handOff((OS_mutex_t *)reason);
+	}else{
+		task = OS_waitList_wakeOne((OS_waitList_t *)reason);
+	}
+	if(task){
+		__makeReady(task);
+	}
+	__releaseAcquiredResource(OS_currentTCB(),reason);
+}
+
+/* puts the task into the sleepWheel, the scheduler will not put it back into the readyHeap until the sleepWheel wakes it.*/
+static void strideScheduler_sleepCallback(OS_TCB_t * const tcb,uint32_t min_sleep_duration){
+	if(min_sleep_duration == 0){
+		return;
+	}
+	if(min_sleep_duration > TIMING_WHEEL_MAX_DELAY){
+		min_sleep_duration = TIMING_WHEEL_MAX_DELAY;
+	}
+	tcb->state |= TASK_STATE_SLEEP;
+	if(!OS_timingWheel_insert(sleepWheel,&tcb->sleepNode,OS_elapsedTicks() + min_sleep_duration)){
+		__wakeTask(tcb);// wake tick already reached
+	}
+}
+
+/* Used by the OS for tickless idle.
+
+RETURNS: number of ticks until the next wakeup (never too late, might be early), UINT32_MAX if no task is sleeping*/
+static uint32_t strideScheduler_ticksUntilNextWakeup(void){
+	return OS_timingWheel_ticksUntilNextEvent(sleepWheel);
+}
+
+//=============================================================================
+// Priority inheritance related
+//=============================================================================
+
+/*changes the tickets of the task depending on the priority of the tasks that are waiting on resources it acquired. The task uses the
+highest priority (lowest value) of those tasks as long as it holds the resources, read from the maxWaiterPriority cached in every mutex.
+Only the stride changes, the pass of the task is left alone, so the new share takes effect from the next time the task is charged.
+
+RETURNS: 1 if the effective priority of the task changed, 0 otherwise*/
+static uint32_t __updatePriorityInheritance(OS_TCB_t * task){
+	return __updatePriorityInheritanceFrom(task,__effectivePriority(task));
+}
+
+/*same as __updatePriorityInheritance, but the effective priority is compared against prevEffectivePriority (the base priority of the
+task was changed before the call, see strideScheduler_setPriority)*/
+static uint32_t __updatePriorityInheritanceFrom(OS_TCB_t * task, uint32_t prevEffectivePriority){
+	OS_mutex_updateInheritedPriority(task);
+	task->stride = __strideOfPriority(__effectivePriority(task));
+	if(prevEffectivePriority == __effectivePriority(task)){
+		return 0;
+	}
+	if(task->waitReason){
+		OS_waitList_reposition((OS_waitList_t *)task->waitReason,task);// keep the wait list the task is queued in ordered
+	}
+	return 1;
+}
+
+/*changes the base priority, and with it the tickets, of a task at run time. Like an inherited priority only the stride changes, the pass
+of the task (and therefore its place in the readyHeap) is left alone and the new share takes effect from the next time the task is
+charged, so this is O(1) apart from moving the task within the wait list it might be queued in.
+
+RETURNS: 1 on success, 0 if the task is not scheduled or the priority is 0*/
+static uint32_t strideScheduler_setPriority(OS_TCB_t * const tcb, uint32_t task_priority){
+	if(tcb == NULL || tcb->stride == 0 || (tcb->state & TASK_STATE_EXIT)){
+		printf("\r\nSTRIDE SCHEDULER: ERROR, cannot change the priority of task %p, it is not scheduled!\r\n",tcb);
+		return 0;
+	}else if(task_priority == 0){
+		printf("\r\nSTRIDE SCHEDULER: ERROR, tried to set priority 0, lowest allowed priority is 1!\r\n");
+		return 0;
+	}
+	uint32_t prevEffectivePriority = __effectivePriority(tcb);
+	tcb->priority = task_priority;
+	if(__updatePriorityInheritanceFrom(tcb,prevEffectivePriority) && tcb->waitingOnMutex){
+		OS_mutex_refreshWaiterPriority((OS_mutex_t *)tcb->waitingOnMutex,__updatePriorityInheritance);
+	}
+	return 1;
+}
+
+static void strideScheduler_resourceAcquired(OS_mutex_t * _acquiredMutex){
+	OS_TCB_t * currentTcb = OS_currentTCB();
+	if(!OS_mutex_registerAcquired(currentTcb,_acquiredMutex)){
+		return;
+	}
+	if(_acquiredMutex->maxWaiterPriority){
+		__updatePriorityInheritance(currentTcb);// handed over mutex that still has waiters
+	}
+}
+
+//=============================================================================
+// Internal utility functions
+//=============================================================================
+
+/* RETURNS: the stride of a task with the given priority (1 = highest)*/
+static uint32_t __strideOfPriority(uint32_t priority){
+	uint32_t tickets = 1;
+	if(priority < STRIDE_SCHEDULER_MAX_TICKETS){
+		tickets = STRIDE_SCHEDULER_MAX_TICKETS + 1 - priority;
+	}
+	return STRIDE_SCHEDULER_STRIDE1 / tickets;
+}
+
+/* returns the priority the task currently runs at (inherited priority if it inherited one, the stride scheduler never biases a priority)*/
+static uint32_t __effectivePriority(OS_TCB_t * task){
+	return TASK_EFFECTIVE_PRIORITY(task);
+}
+
+/* turns the lag stored in the pass field of a task that stopped waiting/sleeping (or was just added) back into a pass and adds the task
+to the readyHeap. The running task is left alone, the scheduler puts it back into the readyHeap when it switches away from it.*/
+static void __makeReady(OS_TCB_t * task){
+	if(task == runningTask){
+		return;
+	}
+	task->pass = globalPass + task->pass;
+	if(!OS_heap_addNode(readyHeap,task,task->pass)){
+		printf("\u001b[31m\r\nSTRIDE SCHEDULER: ERROR, readyHeap is full, unable to add task %p!\r\n",task);
+		DEBUG_schedulerState();
+		printf("\u001b[0m");
+		ASSERT(0);
+	}
+}
+
+/* advances the pass of the task that ran last by its stride for every tick it ran (at least one, a task that yields straight away
+still pays for being selected). If the task is still ready it goes back into the readyHeap, if it waits or sleeps its pass is turned
+into a lag and if it exited it is reclaimed.*/
+static void __chargeRunningTask(void){
+	OS_TCB_t * task = runningTask;
+	if(task == NULL){
+		return;
+	}
+	runningTask = NULL;
+	uint32_t ticksRun = OS_elapsedTicks() - runningTaskStartTick;
+	if(ticksRun == 0){
+		ticksRun = 1;
+	}
+	task->pass += task->stride * ticksRun;
+	if(task->state & TASK_STATE_EXIT){
+		__reclaimTask(task);
+	}else if(task->state & (TASK_STATE_WAIT | TASK_STATE_SLEEP)){
+		task->pass -= globalPass;// lag, always positive since the pass of the running task started at globalPass
+	}else{
+		task->pass -= globalPass;
+		__makeReady(task);
+	}
+}
+
+/* subtracts globalPass from the pass of every task in the readyHeap and from the running task. Their order does not change (every
+pass in the heap is at least globalPass) so the heap does not need to be restored. Waiting and sleeping tasks only store a lag and are
+not affected.*/
+static void __rebasePasses(void){
+	for(uint32_t i=0;i<readyHeap->currentNumNodes;i++){
+		OS_minHeapNode_t * node = OS_heap_nodeAt(readyHeap,i);
+		OS_TCB_t * task = (OS_TCB_t *)node->ptrToNodeContent;
+		task->pass -= globalPass;
+		node->nodeValue = task->pass;
+	}
+	runningTask->pass -= globalPass;
+	globalPass = 0;
+}
+
+/* forgets the exited task that ran last, its stack and TCB are handed back to the memcluster on the next run of the scheduler since the
+context switch still writes to them (see OS_reclaimTaskLater())*/
+static void __reclaimTask(OS_TCB_t * task){
+	numTasks--;
+	OS_reclaimTaskLater(task);
+}
+
+/* makes sure the readyHeap can hold _numTasks tasks. If it can not it grows by another segment of HEAP_SEGMENT_NODES nodes from the
+memcluster (existing nodes are not copied). This is done when a task is added since every task has to fit into the readyHeap whenever
+it is ready.
+
+RETURNS: 1 on success, 0 if the memcluster is in use at the moment, out of memory or _numTasks exceeds HEAP_MAX_NODES*/
+static uint32_t __reserveReadyHeapCapacity(uint32_t _numTasks){
+	if(_numTasks <= readyHeap->maxNumberOfNodes){
+		return 1;
+	}
+	uint32_t success = 0;
+	__disable_irq();
+	if(!OS_isMemclusterInUse()){
+		/* CRITICAL SECTION START (see OS_reclaimTask())*/
+		memory_cluster_setInternalLockState(0);
+		success = OS_heap_grow(readyHeap,_numTasks);
+		memory_cluster_setInternalLockState(1);
+		/* CRITICAL SECTION END*/
+	}
+	__enable_irq();
+	return success;
+}
+
+/* moves a task whose wake tick has been reached out of the sleeping state and back into the readyHeap*/
+static void __wakeTask(OS_TCB_t * task){
+	task->state &= ~TASK_STATE_SLEEP;
+	__makeReady(task);
+}
+
+/* removes a resource the task has released from its list of acquired mutexes and drops any priority it inherited through it*/
+static void __releaseAcquiredResource(OS_TCB_t * task, void * resource){
+	if(OS_mutex_unregisterAcquired(task,resource)){
+		__updatePriorityInheritance(task);
+	}
+}
+
+//=============================================================================
+// DEBUG functions
+//=============================================================================
+
+static void DEBUG_schedulerState(){
+	printf("\r\n\r\n######################################################################\r\n");
+	printf("DEBUG: DUMPING STRIDE SCHEDULER STATE!\r\n");
+	printf("global pass: %u, running task: %p\r\n",globalPass,runningTask);
+	printf("\r\nREADY HEAP:\r\n");
+	printHeap(readyHeap);
+	printf("\r\nSLEEP WHEEL:\r\n");
+	DEBUG_printTimingWheel(sleepWheel);
+}
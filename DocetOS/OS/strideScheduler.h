@@ -0,0 +1,37 @@
+#ifndef DOCETOS_strideScheduler_H
+#define DOCETOS_strideScheduler_H
+
+#include "os.h"
+#include "stm32f4xx.h"
+#include "structs.h"
+#include "../DataStructures/heap.h"
+#include "../DataStructures/timingWheel.h"
+#include "../DataStructures/mutex.h"
+#include "../DataStructures/waitList.h"
+#include "memcluster.h"
+
+/*measured in SysTicks. Longest time a task runs before the scheduler picks again (it may pick the same task)*/
+#define STRIDE_SCHEDULER_QUANTUM_IN_SYSTICKS 10
+
+/* Priorities map to tickets: priority 1 holds STRIDE_SCHEDULER_MAX_TICKETS tickets, every priority below that one ticket less,
+ * down to a single ticket for priority STRIDE_SCHEDULER_MAX_TICKETS and beyond. A task receives CPU time in proportion to its
+ * tickets, e.g. two busy tasks of priority 1 and 17 get 32:16 = 2/3 and 1/3 of the CPU.*/
+#define STRIDE_SCHEDULER_MAX_TICKETS 32
+
+/* stride of a task = STRIDE_SCHEDULER_STRIDE1 / tickets. Divisible by every ticket count up to 32 so strides carry no rounding error
+ * for power of two ticket counts and at most 1 part in 2^15 otherwise.*/
+#define STRIDE_SCHEDULER_STRIDE1 (1UL << 20)
+
+/* once the global pass reaches this value every pass is rebased to keep them far away from overflowing*/
+#define STRIDE_SCHEDULER_REBASE_THRESHOLD (1UL << 31)
+
+/* 1: tasks with equal passes (e.g. tasks of equal priority that were added together) run round robin in the order they became ready.
+ * 0: ties are broken by the shape of the readyHeap.*/
+#define STRIDE_SCHEDULER_FIFO_TIES 1
+
+/* The readyHeap grows by a segment of HEAP_SEGMENT_NODES tasks whenever a task is added that would not fit, so the number of tasks is
+ * only limited by the memory of the memcluster (and HEAP_MAX_NODES).*/
+void initialize_strideScheduler(uint32_t _initialTaskCapacity);
+extern OS_Scheduler_t const strideScheduler;
+
+#endif //DOCETOS_strideScheduler_H
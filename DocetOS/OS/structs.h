@@ -38,23 +38,69 @@ typedef struct __s_node{
     void 	* 	volatile 	ptrToNodeContent;
     /* Node value is used when restoring heap*/
 	uint32_t 	volatile	nodeValue;
+	uint32_t 	volatile	sequence; // order in which nodes were added, breaks ties between equal node values if the heap has fifoTies set
 } OS_minHeapNode_t;
 
 typedef struct __s_heap{
-	/* the heap has an underlying array of nodes. each node holds a value that is used during the
-	 * restoration of the heap (node->nodeValue). */
-	OS_minHeapNode_t 				*   ptrToUnderlyingArray;
+	/* the nodes of the heap are stored in segments of HEAP_SEGMENT_NODES nodes (see OS_heap_nodeAt). each node holds a value that is used
+	 * during the restoration of the heap (node->nodeValue). The heap grows by adding segments, nodes never move between segments. */
+	OS_minHeapNode_t 			* 	* 	segments;
+	uint32_t 										numSegments;
+	uint32_t 										segmentTableSize; // number of segment pointers segments has room for
 	OS_hashtable_t 					* 	nodeContentIndexHashTable; // only created if requested by user, stores node index of a given node content for quick access.
 	uint32_t        						maxNumberOfNodes;
 	uint32_t 					volatile   currentNumNodes;
-	OS_minHeapNode_t 	volatile * nextEmptyElement;
-	OS_minHeapNode_t 				*   lastArrayElement;
+	uint32_t 										fifoTies; // 1: nodes with equal values leave the heap in the order they were added (see OS_heap_setFifoTies)
+	uint32_t 					volatile 	nextSequence;
 } OS_minHeap_t;
 
+//=============================================================================
+// bitmap helpers for timingWheel.c and readyQueue.c
+//=============================================================================
+
+/*number of zero bits below the lowest set bit, 32 for 0. A macro so that __CLZ and __RBIT only have to be declared where it is used*/
+#define OS_COUNT_TRAILING_ZEROS(value) __CLZ(__RBIT(value))
+
+//=============================================================================
+// structs for timingWheel.c
+//=============================================================================
+#define TIMING_WHEEL_SLOT_BITS 5
+#define TIMING_WHEEL_SLOTS_PER_LEVEL (1UL << TIMING_WHEEL_SLOT_BITS) // one slot per bit of a level bitmap
+#define TIMING_WHEEL_NUM_LEVELS 6 // 6 levels of 5 bits cover delays of up to 2^30 ticks without revisiting a node
+#define TIMING_WHEEL_SLOT_NONE UINT32_MAX
+
+typedef struct __s_timingWheelNode{
+	struct __s_timingWheelNode 	* volatile 	next;
+	struct __s_timingWheelNode 	* volatile 	prev;
+	void 												* volatile 	ptrToNodeContent;
+	uint32_t 											volatile 	wakeTick; // absolute tick at which the node expires
+	uint32_t 											volatile 	slot; // index into the slot array of the wheel, TIMING_WHEEL_SLOT_NONE if not in the wheel
+} OS_timingWheelNode_t;
+
+typedef struct{
+	uint32_t 								volatile 	currentTick; // last tick that has been processed by the wheel
+	uint32_t 								volatile 	numNodes;
+	uint32_t 								volatile 	levelBitmap[TIMING_WHEEL_NUM_LEVELS]; // bit n is set if slot n of the level is not empty
+	OS_timingWheelNode_t 	* volatile 	slots[TIMING_WHEEL_NUM_LEVELS * TIMING_WHEEL_SLOTS_PER_LEVEL];
+} OS_timingWheel_t;
+
+//=============================================================================
+// structs for waitList.c
+//=============================================================================
+
+typedef struct{
+	/* intrusive doubly linked list of waiting tasks, the links (waitNext/waitPrev) and the reason a task waits for (waitReason)
+	 * are stored inside the TCBs themselves*/
+	struct __s_TCB 	* volatile 	head;
+	struct __s_TCB 	* volatile 	tail;
+	uint32_t 		volatile 	numTasks;
+	uint32_t 		volatile 	sequence; // bumped by every notify on this object, lets OS_wait() detect a notify it raced with
+} OS_waitList_t;
+
 //=============================================================================
 // structs for os.c
 //=============================================================================
-typedef struct {
+typedef struct __s_TCB {
 	/* Task stack pointer.  It's important that this is the first entry in the structure,
 	   so that a simple double-dereference of a TCB pointer yields a stack pointer. */
 	void 		* 	volatile sp;
@@ -73,17 +119,91 @@ typedef struct {
 	uint32_t 		volatile inheritedPriority; // 0 if nothing inherited
   uint32_t 		volatile prevInheritedPriority; //used to check if inherited priority changed.
 	void 		* 	volatile acquiredResourcesLinkedList; // 0 if no acquired resources
+	void 		* 	volatile waitingOnMutex; // mutex the task is waiting on, NULL if it is not waiting on a mutex
+	void 		* 	volatile waitReason; // object the task is waiting for, NULL if it is not waiting
+	void 		* 	volatile waitNext; // intrusive links of the list of waiting tasks
+	void 		* 	volatile waitPrev;
+	void 		* 	volatile readyNext; // intrusive links of the ready queue list the task is currently linked into
+	void 		* 	volatile readyPrev;
+	uint32_t 		volatile readyLevel; // level of the ready queue list the task is linked into, READY_QUEUE_LEVEL_NONE if not linked
+	OS_timingWheelNode_t 		 sleepNode; // links the task into the timing wheel whilst it is sleeping
+	uint32_t 		volatile pass; // stride scheduler: virtual time the task has consumed (its lag whilst it is blocked)
+	uint32_t 		volatile stride; // stride scheduler: pass added per tick of cpu time, inversely proportional to the tasks tickets
+	uint32_t 		volatile quantum; // ticks the task may run for before the scheduler picks again, 0 = scheduler default
+	uint32_t 		volatile budget; // ticks of cpu time the task may use per budgetPeriod, 0 = unlimited
+	uint32_t 		volatile budgetPeriod;
+	uint32_t 		volatile budgetUsed; // ticks of cpu time used in the current period
+	uint32_t 		volatile budgetPeriodStart; // tick at which the current period started
+	uint32_t 		volatile period; // EDF scheduler: ticks between job releases, 0 if the task is not periodic
+	uint32_t 		volatile relativeDeadline; // EDF scheduler: ticks after its release by which a job has to be done
+	uint32_t 		volatile wcet; // EDF scheduler: worst case execution time of a job in ticks
+	uint32_t 		volatile absoluteDeadline; // EDF scheduler: deadline of the current job
+	uint32_t 		volatile nextRelease; // EDF scheduler: release tick of the current job until it is done, then of the next job
+	uint32_t 		volatile deadlineMisses; // EDF scheduler: number of jobs that were done after their deadline, cyclic scheduler: overrun slots
+	void 		* 	volatile taskGroup; // stochastic scheduler: group the task belongs to, NULL = default group (see OS_setTaskGroup)
+	int32_t 		volatile priorityBias; // stochastic scheduler: adaptive offset to priority, negative = boosted (see SCHEDULER_ADAPTIVE_PRIORITY)
+	uint32_t 		volatile joinable; // 1: the task is reclaimed by OS_join() instead of by the scheduler (see OS_setTaskJoinable)
+	uint32_t 		volatile exitValue; // value the task exited with (see OS_exit)
+	OS_waitList_t 			 joinWaiters; // task waiting in OS_join() for this task to exit
 } OS_TCB_t;
 
+//=============================================================================
+// structs for readyQueue.c
+//=============================================================================
+
+#define READY_QUEUE_NUM_LEVELS 32 // one level per bit of the priority bitmap
+#define READY_QUEUE_LEVEL_NONE UINT32_MAX
+
+typedef struct{
+	/* bit (31 - level) is set whenever the list of that level holds at least one task. Level 0 is the MSB so that
+	 * the highest priority non empty level can be found with a single CLZ instruction.*/
+	uint32_t 		volatile 	priorityBitmap;
+	uint32_t 		volatile 	numTasks;
+	OS_TCB_t 		* volatile 	levelHead[READY_QUEUE_NUM_LEVELS];
+	OS_TCB_t 		* volatile 	levelTail[READY_QUEUE_NUM_LEVELS];
+	/* weighted selection (see OS_readyQueue_sampleLevel): every task contributes the weight of its level. weightTree is a
+	 * fenwick tree over the levels holding the summed weight of their tasks, so both updating and sampling take log2(32) steps*/
+	uint32_t 							levelWeight[READY_QUEUE_NUM_LEVELS];
+	uint32_t 		volatile 	weightTree[READY_QUEUE_NUM_LEVELS];
+	uint32_t 		volatile 	totalWeight;
+} OS_readyQueue_t;
+
+//=============================================================================
+// structs for task groups (stochasticScheduler.c)
+//=============================================================================
+
+typedef struct __s_taskGroup{
+	OS_readyQueue_t 				* 				readyQueue; // ready tasks of the group, the scheduler picks a task in here once it picked the group
+	struct __s_taskGroup 		* 				next; // every group of the scheduler is chained into a single list
+	uint32_t 											share; // weight of the group when the scheduler picks a group
+	uint32_t 								volatile 	budget; // ticks of cpu time the whole group may use per budgetPeriod, 0 = uncapped
+	uint32_t 								volatile 	budgetPeriod;
+	uint32_t 								volatile 	budgetUsed; // ticks of cpu time used in the current period
+	uint32_t 								volatile 	budgetPeriodStart; // tick at which the current period started
+	uint32_t 								volatile 	recentUsage; // ticks of cpu time used recently, decays (see __chargeGroup)
+} OS_taskGroup_t;
+
+//=============================================================================
+// structs for cyclicScheduler.c
+//=============================================================================
+
+typedef struct{
+	uint32_t 								offset; // tick within the major frame at which the slot starts
+	OS_TCB_t 				* 			task; // task that is dispatched at offset
+	uint32_t 								budget; // ticks the task may run for, a job that is not done by then overran its slot
+} OS_cyclicSlot_t;
+
 //=============================================================================
 // structs for mutex.c
 //=============================================================================
 
 typedef struct{
+	OS_waitList_t 				waiters; // tasks waiting for the mutex, MUST be the first member (see waitList.c)
 	uint32_t 							counter;
 	uint32_t 		volatile 	svcDelegatesEnabled;// enable/disable notify/wait callbacks 
 	OS_TCB_t 		* 				tcbPointer;//tcb that holds this lock
 	void 				* 				nextAcquiredResource; // points to the next resource acquired by task (or NULL if no other resource)
+	uint32_t 		volatile 	maxWaiterPriority; // highest (lowest value) effective priority of the tasks waiting on this mutex, 0 if none
 } OS_mutex_t;
 
 //=============================================================================
@@ -91,6 +211,8 @@ typedef struct{
 //=============================================================================
 
 typedef struct{
+	OS_waitList_t 		waiters; // tasks waiting for a token, MUST be the first member (see waitList.c)
+	OS_waitList_t 		spaceWaiters; // tasks waiting to release a token whilst the semaphore is full
 	uint32_t 	volatile 	availableTokens;
     uint32_t 				maxTokens;
 } OS_semaphore_t;
@@ -33,6 +33,19 @@ typedef struct s_StackFrame {
 #define TASK_STATE_YIELD    (1UL << 0) // Bit zero is the 'yield' flag
 #define TASK_STATE_SLEEP		(1UL << 1) // sleep flag
 #define TASK_STATE_WAIT			(1UL << 2) // wait flag
-#define TASK_STATE_EXIT			(1UL << 3) // tells the scheduler to remove this task from all hashtables and heaps
+#define TASK_STATE_EXIT			(1UL << 3) // tells the scheduler to remove this task from all of its queues
+#define TASK_STATE_THROTTLED	(1UL << 4) // task used up its cpu budget and is not run until the budget is replenished
+#define TASK_STATE_PERIOD_WAIT	(1UL << 5) // periodic task finished its job and waits for the release of the next one
+#define TASK_STATE_SCHEDULED	(1UL << 6) // task has been added to the scheduler, set until its memory is reclaimed
+#define TASK_STATE_SUSPENDED	(1UL << 7) // task is parked by OS_suspend() and not run until OS_resume(), independent of sleep/wait
+
+/* priority of a task adjusted by its adaptive bias (see SCHEDULER_ADAPTIVE_PRIORITY in stochasticScheduler.h), never below 1. This is
+   the priority the task has unless it inherited a higher one, it equals task->priority for every task whose bias is 0. */
+#define TASK_BIASED_PRIORITY(task) \
+	(((int32_t)(task)->priority + (task)->priorityBias < 1) ? 1UL : (uint32_t)((int32_t)(task)->priority + (task)->priorityBias))
+
+/* priority the task currently runs at: the priority it inherited through a mutex if it inherited one, TASK_BIASED_PRIORITY otherwise.
+   Wait lists and priority inheritance use this value. */
+#define TASK_EFFECTIVE_PRIORITY(task) ((task)->inheritedPriority ? (task)->inheritedPriority : TASK_BIASED_PRIORITY(task))
 
 #endif /* _TASK_H_ */
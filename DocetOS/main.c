@@ -12,10 +12,12 @@
 #include "../DataStructures/channel.h"
 
 #define MEMPOOL_SIZE 26384 
+#define NUM_TASKS 14 // tasks main() adds, the scheduler grows beyond this should more be added
 __align(8)
 static uint32_t memory[MEMPOOL_SIZE]; 
 
 static OS_mutex_t printLock, task5_8Lock;
+static OS_taskGroup_t * producerGroup; // task9-task12 share one slice of the cpu however many of them run
 static volatile uint32_t taskcounter1,taskcounter2,taskcounter3,taskcounter4,taskcounter5,taskcounter6,taskcounter7,taskcounter8 = 0;
 
 void task1(void const *const args) {
@@ -178,6 +180,10 @@ void task13(void const *const args) {
 	OS_initialiseTCB(TCB10, stack10+64, task10, 0);
 	OS_initialiseTCB(TCB11, stack11+64, task11, 0);
 	OS_initialiseTCB(TCB12, stack12+64, task12, 0);
+	OS_setTaskGroup(TCB9,producerGroup);
+	OS_setTaskGroup(TCB10,producerGroup);
+	OS_setTaskGroup(TCB11,producerGroup);
+	OS_setTaskGroup(TCB12,producerGroup);
 	OS_addTask(TCB9,9);
 	OS_addTask(TCB10,10);
 	OS_addTask(TCB11,11);
@@ -252,7 +258,8 @@ int main(void) {
 
 	/* Initialise the OS */
 	
-	OS_init(&stochasticScheduler,memory,MEMPOOL_SIZE);
+	OS_init(&stochasticScheduler,memory,MEMPOOL_SIZE,NUM_TASKS);
+	producerGroup = OS_stochastic_newTaskGroup(STOCHASTIC_DEFAULT_GROUP_SHARE/2);
 
 	OS_TCB_t * TCB0 = (OS_TCB_t*)OS_alloc(sizeof(OS_TCB_t));
 	uint32_t * stack0 = OS_alloc(64);